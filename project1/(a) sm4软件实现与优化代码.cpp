@@ -3,6 +3,7 @@
 #include<array>
 #include<cstddef>
 #include <cstdint>
+#include <cstring>
 #include <emmintrin.h>
 
 // 防止编译器优化掉关键操作
@@ -17,7 +18,7 @@ void xor5Bytes(uint8_t result[4], const uint8_t a[4], const uint8_t b[4], const
 
 uint8_t Plaintext[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10 };
 uint8_t Key[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10 };
-uint8_t Sbox[256] = {
+constexpr uint8_t Sbox[256] = {
     0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2, 0x28, 0xfb, 0x2c, 0x05,
     0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3, 0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
     0x9c, 0x42, 0x50, 0xf4, 0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
@@ -35,8 +36,8 @@ uint8_t Sbox[256] = {
     0x89, 0x69, 0x97, 0x4a, 0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
     0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e, 0xd7, 0xcb, 0x39, 0x48
 };
-uint32_t FK[4] = { 0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc };
-uint32_t CK[32] = {
+constexpr uint32_t FK[4] = { 0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc };
+constexpr uint32_t CK[32] = {
     0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269,
     0x70777e85, 0x8c939aa1, 0xa8afb6bd, 0xc4cbd2d9,
     0xe0e7eef5, 0xfc030a11, 0x181f262d, 0x343b4249,
@@ -47,9 +48,8 @@ uint32_t CK[32] = {
     0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279
 };
 
-uint8_t* T_func(uint8_t* x) {
-    static uint8_t result[4];
-
+// 结果写入调用者提供的result，不使用静态缓冲区，可重入
+void T_func(const uint8_t* x, uint8_t result[4]) {
     // S盒代换
     uint8_t b[4];
     for (int i = 0; i < 4; ++i) {
@@ -71,21 +71,19 @@ uint8_t* T_func(uint8_t* x) {
     result[1] = (L >> 16) & 0xFF;
     result[2] = (L >> 8) & 0xFF;
     result[3] = L & 0xFF;
-
-    return result;
 }
 
-uint8_t* SM4Round(uint8_t x1[4], uint8_t x2[4], uint8_t x3[4], uint8_t x4[4], uint8_t* rk) {
-    uint8_t result[4];
+void SM4Round(const uint8_t x1[4], const uint8_t x2[4], const uint8_t x3[4], const uint8_t x4[4], const uint8_t rk[4], uint8_t result[4]) {
     uint8_t temp[4];
+    uint8_t t[4];
     xor4Bytes(temp, x2, x3, x4, rk);
-    xor2Bytes(result, x1, T_func(temp));
-    return result;
+    T_func(temp, t);
+    xor2Bytes(result, x1, t);
 }
 
 uint32_t T_Kgen(uint32_t K) {
-    static uint8_t A[4];
-    static uint8_t B[4];
+    uint8_t A[4];
+    uint8_t B[4];
     // 将32位结果拆分为4字节
     A[0] = (K >> 24) & 0xFF;
     A[1] = (K >> 16) & 0xFF;
@@ -104,13 +102,13 @@ uint32_t T_Kgen(uint32_t K) {
     return L;
 }
 
-void RoundKeyGen(uint32_t rk[32], uint8_t key[16]) {
+void RoundKeyGen(uint32_t rk[32], const uint8_t key[16]) {
     uint32_t K[36];
     uint32_t key_word[4];
-    key_word[0] = key[0] | key[1] | key[2] | key[3];
-    key_word[1] = key[4] | key[5] | key[6] | key[7];
-    key_word[2] = key[8] | key[9] | key[10] | key[11];
-    key_word[3] = key[12] | key[13] | key[14] | key[15];
+    key_word[0] = (key[0] << 24) | (key[1] << 16) | (key[2] << 8) | key[3];
+    key_word[1] = (key[4] << 24) | (key[5] << 16) | (key[6] << 8) | key[7];
+    key_word[2] = (key[8] << 24) | (key[9] << 16) | (key[10] << 8) | key[11];
+    key_word[3] = (key[12] << 24) | (key[13] << 16) | (key[14] << 8) | key[15];
     for (int i = 0; i < 4; ++i) {
         K[i] = key_word[i] ^ FK[i];
     }
@@ -122,17 +120,17 @@ void RoundKeyGen(uint32_t rk[32], uint8_t key[16]) {
     }
 }
 
-void SM4Encrypt(uint8_t* input, uint8_t* output, uint32_t rk[32]) {
+void SM4Encrypt(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
     uint8_t x[36][4];
-    for (int i = 0; i < 16; ++i) { // initial vector
-        x[0][i] = input[i];
+    for (int i = 0; i < 4; ++i) { // initial vector
+        for (int j = 0; j < 4; ++j) {
+            x[i][j] = input[i * 4 + j];
+        }
     }
     for (int i = 0; i < 32; ++i) { // round func
-        uint8_t* temp = SM4Round(x[i], x[i + 1], x[i + 2], x[i + 3], (uint8_t*)&rk[i]);
-        x[i + 4][0] = temp[0];
-        x[i + 4][1] = temp[1];
-        x[i + 4][2] = temp[2];
-        x[i + 4][3] = temp[3];
+        // 轮密钥按大端序拆成字节，与状态字节序一致
+        uint8_t rk_bytes[4] = { (uint8_t)(rk[i] >> 24), (uint8_t)(rk[i] >> 16), (uint8_t)(rk[i] >> 8), (uint8_t)rk[i] };
+        SM4Round(x[i], x[i + 1], x[i + 2], x[i + 3], rk_bytes, x[i + 4]);
     }
     // reverse
     output[0] = x[35][0];
@@ -158,88 +156,1617 @@ void SM4Encrypt(uint8_t* input, uint8_t* output, uint32_t rk[32]) {
 #include <iostream>
 #include <cstdint>
 
-// 预计算T-table
-uint32_t T_table[256];
+// 编译期生成的T-table，位于只读数据段，启动时无需初始化，加密路径上也没有初始化检查
+// SM4_T_TABLES[k][b] = L(Sbox[b] << (24 - 8k))：第k个字节位置的表已预先循环右移8k位，
+// 查表后不再需要循环移位
+constexpr uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// 线性变换L
+constexpr uint32_t sm4_L(uint32_t b) {
+    return b ^ rotl32(b, 2) ^ rotl32(b, 10) ^ rotl32(b, 18) ^ rotl32(b, 24);
+}
+
+struct SM4TTables {
+    uint32_t t[4][256];
+};
+
+constexpr SM4TTables make_T_tables() {
+    SM4TTables r{};
+    for (int k = 0; k < 4; ++k) {
+        for (int i = 0; i < 256; ++i) {
+            r.t[k][i] = sm4_L((uint32_t)Sbox[i] << (24 - 8 * k));
+        }
+    }
+    return r;
+}
+
+alignas(64) constexpr SM4TTables SM4_T_TABLES = make_T_tables();
+static_assert(SM4_T_TABLES.t[0][0] == 0x8ed55b5b, "T-table与L(Sbox[0] << 24)不一致");
+
+// 优化后的T_func使用T-table
+inline uint32_t T_func_optimized(uint32_t word) {
+    return SM4_T_TABLES.t[0][word >> 24] ^
+        SM4_T_TABLES.t[1][(word >> 16) & 0xFF] ^
+        SM4_T_TABLES.t[2][(word >> 8) & 0xFF] ^
+        SM4_T_TABLES.t[3][word & 0xFF];
+}
+
+// 优化后的轮函数
+uint32_t SM4Round_optimized(uint32_t x1, uint32_t x2, uint32_t x3, uint32_t x4, uint32_t rk) {
+    return x1 ^ T_func_optimized(x2 ^ x3 ^ x4 ^ rk);
+}
+
+// 优化后的加密函数
+void SM4Encrypt_optimized(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    // 将输入转换为32位字 (大端序)
+    uint32_t x[36];
+    x[0] = (input[0] << 24) | (input[1] << 16) | (input[2] << 8) | input[3];
+    x[1] = (input[4] << 24) | (input[5] << 16) | (input[6] << 8) | input[7];
+    x[2] = (input[8] << 24) | (input[9] << 16) | (input[10] << 8) | input[11];
+    x[3] = (input[12] << 24) | (input[13] << 16) | (input[14] << 8) | input[15];
+
+    // 32轮加密 (部分展开)
+    for (int i = 0; i < 32; i += 4) {
+        x[i + 4] = SM4Round_optimized(x[i], x[i + 1], x[i + 2], x[i + 3], rk[i]);
+        x[i + 5] = SM4Round_optimized(x[i + 1], x[i + 2], x[i + 3], x[i + 4], rk[i + 1]);
+        x[i + 6] = SM4Round_optimized(x[i + 2], x[i + 3], x[i + 4], x[i + 5], rk[i + 2]);
+        x[i + 7] = SM4Round_optimized(x[i + 3], x[i + 4], x[i + 5], x[i + 6], rk[i + 3]);
+    }
+
+    // 反序变换并输出
+    uint32_t out0 = x[35], out1 = x[34], out2 = x[33], out3 = x[32];
+    output[0] = (out0 >> 24) & 0xFF;
+    output[1] = (out0 >> 16) & 0xFF;
+    output[2] = (out0 >> 8) & 0xFF;
+    output[3] = out0 & 0xFF;
+    output[4] = (out1 >> 24) & 0xFF;
+    output[5] = (out1 >> 16) & 0xFF;
+    output[6] = (out1 >> 8) & 0xFF;
+    output[7] = out1 & 0xFF;
+    output[8] = (out2 >> 24) & 0xFF;
+    output[9] = (out2 >> 16) & 0xFF;
+    output[10] = (out2 >> 8) & 0xFF;
+    output[11] = out2 & 0xFF;
+    output[12] = (out3 >> 24) & 0xFF;
+    output[13] = (out3 >> 16) & 0xFF;
+    output[14] = (out3 >> 8) & 0xFF;
+    output[15] = out3 & 0xFF;
+}
+
+// 多分组并行优化 (AES-NI S盒同构)
+// SM4与AES的S盒都基于GF(2^8)求逆，两个域同构，因此
+// SM4_Sbox(x) = A2(AES_Sbox(A1(x)))，A1/A2为仿射变换，用4比特查表(pshufb)实现，
+// AES_Sbox由AESENCLAST(轮密钥为0)计算。每个寄存器存放4个分组的同一个字，
+// 4(SSE)/8(AVX2)个分组同时完成32轮。
+// SIMD函数用target属性单独指定指令集，无需 -maes/-mavx2 编译选项，
+// 运行时按CPU特性选择调用哪一组实现(见后面的"运行时后端分派")。
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SM4_TARGET(features) __attribute__((target(features)))
+#define SM4_FLATTEN __attribute__((flatten))
+#else
+#define SM4_TARGET(features)
+#define SM4_FLATTEN
+#endif
+#define SM4_TARGET_AESNI SM4_TARGET("ssse3,aes")
+#define SM4_TARGET_AVX2 SM4_TARGET("avx2,aes")
+#define SM4_TARGET_VAES SM4_TARGET("avx2,aes,vaes")
+
+// 仿射变换A1/A2的低4位、高4位查表
+#define SM4_PRE_TF_LO  _mm_set_epi64x((long long)0xC7C1B4B222245157ULL, (long long)0x9197E2E474720701ULL)
+#define SM4_PRE_TF_HI  _mm_set_epi64x((long long)0xF052B91BF95BB012ULL, (long long)0xE240AB09EB49A200ULL)
+#define SM4_POST_TF_LO _mm_set_epi64x((long long)0xEDD14478172BBE82ULL, (long long)0x5B67F2CEA19D0834ULL)
+#define SM4_POST_TF_HI _mm_set_epi64x((long long)0x11CDBE62CC1063BFULL, (long long)0xAE7201DD73AFDC00ULL)
+// AESENCLAST自带ShiftRows，先做逆ShiftRows抵消
+#define SM4_INV_SHIFT_ROW _mm_set_epi8(3, 6, 9, 12, 15, 2, 5, 8, 11, 14, 1, 4, 7, 10, 13, 0)
+// 32位字内字节置换：大小端转换、循环左移8/16/24位
+#define SM4_BSWAP32 _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3)
+#define SM4_ROL8    _mm_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3)
+#define SM4_ROL16   _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2)
+#define SM4_ROL24   _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1)
+
+// 对128位寄存器中的16个字节做4比特查表仿射变换
+SM4_TARGET_AESNI static inline __m128i affine_transform_sse(__m128i x, __m128i lo_t, __m128i hi_t) {
+    const __m128i mask4 = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_and_si128(x, mask4);
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(x, 4), mask4);
+    return _mm_xor_si128(_mm_shuffle_epi8(lo_t, lo), _mm_shuffle_epi8(hi_t, hi));
+}
+
+// 16个字节并行过SM4 S盒
+SM4_TARGET_AESNI static inline __m128i sm4_sbox_sse(__m128i x) {
+    x = affine_transform_sse(x, SM4_PRE_TF_LO, SM4_PRE_TF_HI);
+    x = _mm_shuffle_epi8(x, SM4_INV_SHIFT_ROW);
+    x = _mm_aesenclast_si128(x, _mm_setzero_si128());
+    return affine_transform_sse(x, SM4_POST_TF_LO, SM4_POST_TF_HI);
+}
+
+// 合成置换T = L(tau(x))，L(B) = B ^ (B<<<24) ^ ((B ^ B<<<8 ^ B<<<16)<<<2)
+SM4_TARGET_AESNI static inline __m128i sm4_T_sse(__m128i x) {
+    x = sm4_sbox_sse(x);
+    __m128i t = _mm_xor_si128(x, _mm_xor_si128(_mm_shuffle_epi8(x, SM4_ROL8), _mm_shuffle_epi8(x, SM4_ROL16)));
+    t = _mm_or_si128(_mm_slli_epi32(t, 2), _mm_srli_epi32(t, 30));
+    return _mm_xor_si128(_mm_xor_si128(x, _mm_shuffle_epi8(x, SM4_ROL24)), t);
+}
+
+// 4x4的32位字转置：分组布局 <-> 字布局
+SM4_TARGET_AESNI static inline void transpose_4x4_sse(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3) {
+    __m128i t0 = _mm_unpacklo_epi32(x0, x1);
+    __m128i t1 = _mm_unpacklo_epi32(x2, x3);
+    __m128i t2 = _mm_unpackhi_epi32(x0, x1);
+    __m128i t3 = _mm_unpackhi_epi32(x2, x3);
+    x0 = _mm_unpacklo_epi64(t0, t1);
+    x1 = _mm_unpackhi_epi64(t0, t1);
+    x2 = _mm_unpacklo_epi64(t2, t3);
+    x3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// 载入4个分组并转置为字布局：x0..x3分别为4个分组的第0..3个字
+SM4_TARGET_AESNI static inline void sm4_load4_sse(const uint8_t* input, __m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3) {
+    x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 0)), SM4_BSWAP32);
+    x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 16)), SM4_BSWAP32);
+    x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 32)), SM4_BSWAP32);
+    x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 48)), SM4_BSWAP32);
+    transpose_4x4_sse(x0, x1, x2, x3);
+}
+
+// 反序变换并输出
+SM4_TARGET_AESNI static inline void sm4_store4_sse(uint8_t* output, __m128i x0, __m128i x1, __m128i x2, __m128i x3) {
+    transpose_4x4_sse(x3, x2, x1, x0);
+    _mm_storeu_si128((__m128i*)(output + 0), _mm_shuffle_epi8(x3, SM4_BSWAP32));
+    _mm_storeu_si128((__m128i*)(output + 16), _mm_shuffle_epi8(x2, SM4_BSWAP32));
+    _mm_storeu_si128((__m128i*)(output + 32), _mm_shuffle_epi8(x1, SM4_BSWAP32));
+    _mm_storeu_si128((__m128i*)(output + 48), _mm_shuffle_epi8(x0, SM4_BSWAP32));
+}
+
+// 连续4轮，k0..k3为各轮的轮密钥向量(每个通道可以不同)
+SM4_TARGET_AESNI static inline void sm4_4rounds_sse(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3,
+    __m128i k0, __m128i k1, __m128i k2, __m128i k3) {
+    x0 = _mm_xor_si128(x0, sm4_T_sse(_mm_xor_si128(_mm_xor_si128(x1, x2), _mm_xor_si128(x3, k0))));
+    x1 = _mm_xor_si128(x1, sm4_T_sse(_mm_xor_si128(_mm_xor_si128(x2, x3), _mm_xor_si128(x0, k1))));
+    x2 = _mm_xor_si128(x2, sm4_T_sse(_mm_xor_si128(_mm_xor_si128(x3, x0), _mm_xor_si128(x1, k2))));
+    x3 = _mm_xor_si128(x3, sm4_T_sse(_mm_xor_si128(_mm_xor_si128(x0, x1), _mm_xor_si128(x2, k3))));
+}
+
+// 4分组并行加密
+SM4_TARGET_AESNI void SM4Encrypt4_aesni(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    __m128i x0, x1, x2, x3;
+    sm4_load4_sse(input, x0, x1, x2, x3);
+    for (int i = 0; i < 32; i += 4) {
+        sm4_4rounds_sse(x0, x1, x2, x3, _mm_set1_epi32(rk[i]), _mm_set1_epi32(rk[i + 1]),
+            _mm_set1_epi32(rk[i + 2]), _mm_set1_epi32(rk[i + 3]));
+    }
+    sm4_store4_sse(output, x0, x1, x2, x3);
+}
+
+SM4_TARGET_AVX2 static inline __m256i broadcast_sse(__m128i x) { return _mm256_broadcastsi128_si256(x); }
+
+SM4_TARGET_AVX2 static inline __m256i affine_transform_avx2(__m256i x, __m128i lo_t, __m128i hi_t) {
+    const __m256i mask4 = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(x, mask4);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(x, 4), mask4);
+    return _mm256_xor_si256(_mm256_shuffle_epi8(broadcast_sse(lo_t), lo), _mm256_shuffle_epi8(broadcast_sse(hi_t), hi));
+}
+
+// 256位AESENCLAST(VAES)。单独标注target，由带VAES属性的入口函数flatten内联
+SM4_TARGET_VAES static inline __m256i aesenclast_vaes(__m256i x) {
+    return _mm256_aesenclast_epi128(x, _mm256_setzero_si256());
+}
+
+// 32个字节并行过SM4 S盒，VAES为false时AESENCLAST按128位拆开执行
+// AVX2路径的模板参数VAES都表示是否使用256位AESENCLAST，入口函数分别实例化
+template <bool VAES>
+SM4_TARGET_AVX2 static inline __m256i sm4_sbox_avx2(__m256i x) {
+    x = affine_transform_avx2(x, SM4_PRE_TF_LO, SM4_PRE_TF_HI);
+    x = _mm256_shuffle_epi8(x, broadcast_sse(SM4_INV_SHIFT_ROW));
+    if (VAES) {
+        x = aesenclast_vaes(x);
+    }
+    else {
+        __m128i lo = _mm_aesenclast_si128(_mm256_castsi256_si128(x), _mm_setzero_si128());
+        __m128i hi = _mm_aesenclast_si128(_mm256_extracti128_si256(x, 1), _mm_setzero_si128());
+        x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    }
+    return affine_transform_avx2(x, SM4_POST_TF_LO, SM4_POST_TF_HI);
+}
+
+template <bool VAES>
+SM4_TARGET_AVX2 static inline __m256i sm4_T_avx2(__m256i x) {
+    x = sm4_sbox_avx2<VAES>(x);
+    __m256i t = _mm256_xor_si256(x, _mm256_xor_si256(_mm256_shuffle_epi8(x, broadcast_sse(SM4_ROL8)),
+        _mm256_shuffle_epi8(x, broadcast_sse(SM4_ROL16))));
+    t = _mm256_or_si256(_mm256_slli_epi32(t, 2), _mm256_srli_epi32(t, 30));
+    return _mm256_xor_si256(_mm256_xor_si256(x, _mm256_shuffle_epi8(x, broadcast_sse(SM4_ROL24))), t);
+}
+
+// 每个128位通道内做4x4转置
+SM4_TARGET_AVX2 static inline void transpose_4x4_avx2(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3) {
+    __m256i t0 = _mm256_unpacklo_epi32(x0, x1);
+    __m256i t1 = _mm256_unpacklo_epi32(x2, x3);
+    __m256i t2 = _mm256_unpackhi_epi32(x0, x1);
+    __m256i t3 = _mm256_unpackhi_epi32(x2, x3);
+    x0 = _mm256_unpacklo_epi64(t0, t1);
+    x1 = _mm256_unpackhi_epi64(t0, t1);
+    x2 = _mm256_unpacklo_epi64(t2, t3);
+    x3 = _mm256_unpackhi_epi64(t2, t3);
+}
+
+// 载入8个分组：低128位通道为第0,2,4,6个分组，高128位通道为第1,3,5,7个分组
+SM4_TARGET_AVX2 static inline void sm4_load8_avx2(const uint8_t* input, __m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3) {
+    const __m256i bswap = broadcast_sse(SM4_BSWAP32);
+    x0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(input + 0)), bswap);
+    x1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(input + 32)), bswap);
+    x2 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(input + 64)), bswap);
+    x3 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(input + 96)), bswap);
+    transpose_4x4_avx2(x0, x1, x2, x3);
+}
+
+SM4_TARGET_AVX2 static inline void sm4_store8_avx2(uint8_t* output, __m256i x0, __m256i x1, __m256i x2, __m256i x3) {
+    const __m256i bswap = broadcast_sse(SM4_BSWAP32);
+    transpose_4x4_avx2(x3, x2, x1, x0);
+    _mm256_storeu_si256((__m256i*)(output + 0), _mm256_shuffle_epi8(x3, bswap));
+    _mm256_storeu_si256((__m256i*)(output + 32), _mm256_shuffle_epi8(x2, bswap));
+    _mm256_storeu_si256((__m256i*)(output + 64), _mm256_shuffle_epi8(x1, bswap));
+    _mm256_storeu_si256((__m256i*)(output + 96), _mm256_shuffle_epi8(x0, bswap));
+}
+
+template <bool VAES>
+SM4_TARGET_AVX2 static inline void sm4_4rounds_avx2(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3,
+    __m256i k0, __m256i k1, __m256i k2, __m256i k3) {
+    x0 = _mm256_xor_si256(x0, sm4_T_avx2<VAES>(_mm256_xor_si256(_mm256_xor_si256(x1, x2), _mm256_xor_si256(x3, k0))));
+    x1 = _mm256_xor_si256(x1, sm4_T_avx2<VAES>(_mm256_xor_si256(_mm256_xor_si256(x2, x3), _mm256_xor_si256(x0, k1))));
+    x2 = _mm256_xor_si256(x2, sm4_T_avx2<VAES>(_mm256_xor_si256(_mm256_xor_si256(x3, x0), _mm256_xor_si256(x1, k2))));
+    x3 = _mm256_xor_si256(x3, sm4_T_avx2<VAES>(_mm256_xor_si256(_mm256_xor_si256(x0, x1), _mm256_xor_si256(x2, k3))));
+}
+
+// 8分组并行加密
+template <bool VAES>
+SM4_TARGET_AVX2 static inline void sm4_encrypt8_avx2(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    __m256i x0, x1, x2, x3;
+    sm4_load8_avx2(input, x0, x1, x2, x3);
+    for (int i = 0; i < 32; i += 4) {
+        sm4_4rounds_avx2<VAES>(x0, x1, x2, x3, _mm256_set1_epi32(rk[i]), _mm256_set1_epi32(rk[i + 1]),
+            _mm256_set1_epi32(rk[i + 2]), _mm256_set1_epi32(rk[i + 3]));
+    }
+    sm4_store8_avx2(output, x0, x1, x2, x3);
+}
+
+SM4_TARGET_AVX2 SM4_FLATTEN void SM4Encrypt8_avx2(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    sm4_encrypt8_avx2<false>(input, output, rk);
+}
+
+SM4_TARGET_VAES SM4_FLATTEN void SM4Encrypt8_vaes(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    sm4_encrypt8_avx2<true>(input, output, rk);
+}
+
+// 各后端的多分组加密(ECB)：先按8/4分组走SIMD路径，剩余分组回退到单分组T-table实现
+static void sm4_blocks_scalar(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    for (size_t i = 0; i < nblocks; ++i) {
+        SM4Encrypt_optimized(input + i * 16, output + i * 16, rk);
+    }
+}
+
+static void sm4_blocks_aesni(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    size_t i = 0;
+    for (; i + 4 <= nblocks; i += 4) {
+        SM4Encrypt4_aesni(input + i * 16, output + i * 16, rk);
+    }
+    sm4_blocks_scalar(input + i * 16, output + i * 16, nblocks - i, rk);
+}
+
+static void sm4_blocks_avx2(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    size_t i = 0;
+    for (; i + 8 <= nblocks; i += 8) {
+        SM4Encrypt8_avx2(input + i * 16, output + i * 16, rk);
+    }
+    sm4_blocks_aesni(input + i * 16, output + i * 16, nblocks - i, rk);
+}
+
+static void sm4_blocks_vaes(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    size_t i = 0;
+    for (; i + 8 <= nblocks; i += 8) {
+        SM4Encrypt8_vaes(input + i * 16, output + i * 16, rk);
+    }
+    sm4_blocks_aesni(input + i * 16, output + i * 16, nblocks - i, rk);
+}
+
+// 批量多密钥密钥扩展
+// 每个32位通道对应一个密钥：K[i+4] = K[i] ^ T'(K[i+1] ^ K[i+2] ^ K[i+3] ^ CK[i])，
+// T'的S盒同样用AESENCLAST计算。SSE一次扩展8个密钥，AVX2一次扩展16个密钥，
+// 两组交错执行以隐藏S盒延迟。
+// 密钥扩展用的合成置换T' = L'(tau(x))，L'(B) = B ^ (B<<<13) ^ (B<<<23)
+SM4_TARGET_AESNI static inline __m128i sm4_Tkey_sse(__m128i x) {
+    x = sm4_sbox_sse(x);
+    __m128i r13 = _mm_or_si128(_mm_slli_epi32(x, 13), _mm_srli_epi32(x, 19));
+    __m128i r23 = _mm_or_si128(_mm_slli_epi32(x, 23), _mm_srli_epi32(x, 9));
+    return _mm_xor_si128(x, _mm_xor_si128(r13, r23));
+}
+
+// 8个密钥并行扩展：keys为8个连续的16字节密钥，rks[0..7]为对应轮密钥
+SM4_TARGET_AESNI void RoundKeyGen8_aesni(uint32_t (*rks)[32], const uint8_t* keys) {
+    __m128i K[2][4];
+    for (int g = 0; g < 2; ++g) {
+        sm4_load4_sse(keys + g * 64, K[g][0], K[g][1], K[g][2], K[g][3]);
+        for (int w = 0; w < 4; ++w) {
+            K[g][w] = _mm_xor_si128(K[g][w], _mm_set1_epi32(FK[w]));
+        }
+    }
+    for (int i = 0; i < 32; i += 4) {
+        for (int j = 0; j < 4; ++j) {
+            const __m128i ck = _mm_set1_epi32(CK[i + j]);
+            for (int g = 0; g < 2; ++g) {
+                __m128i t = _mm_xor_si128(_mm_xor_si128(K[g][(j + 1) & 3], K[g][(j + 2) & 3]), _mm_xor_si128(K[g][(j + 3) & 3], ck));
+                K[g][j] = _mm_xor_si128(K[g][j], sm4_Tkey_sse(t));
+            }
+        }
+        // K[g][0..3]为rk[i..i+3]，转置后每个寄存器是一个密钥的4个轮密钥
+        for (int g = 0; g < 2; ++g) {
+            __m128i r0 = K[g][0], r1 = K[g][1], r2 = K[g][2], r3 = K[g][3];
+            transpose_4x4_sse(r0, r1, r2, r3);
+            _mm_storeu_si128((__m128i*)(rks[g * 4 + 0] + i), r0);
+            _mm_storeu_si128((__m128i*)(rks[g * 4 + 1] + i), r1);
+            _mm_storeu_si128((__m128i*)(rks[g * 4 + 2] + i), r2);
+            _mm_storeu_si128((__m128i*)(rks[g * 4 + 3] + i), r3);
+        }
+    }
+}
+
+// 4个分组各用一把密钥加密，decrypt为true时按逆序使用轮密钥
+SM4_TARGET_AESNI void SM4Encrypt4_multikey_aesni(const uint8_t* input, uint8_t* output, const uint32_t (*rks)[32], bool decrypt) {
+    __m128i x0, x1, x2, x3;
+    sm4_load4_sse(input, x0, x1, x2, x3);
+    for (int i = 0; i < 32; i += 4) {
+        // 4个密钥的rk[off..off+3]转置为4个轮密钥向量
+        int off = decrypt ? 28 - i : i;
+        __m128i k0 = _mm_loadu_si128((const __m128i*)(rks[0] + off));
+        __m128i k1 = _mm_loadu_si128((const __m128i*)(rks[1] + off));
+        __m128i k2 = _mm_loadu_si128((const __m128i*)(rks[2] + off));
+        __m128i k3 = _mm_loadu_si128((const __m128i*)(rks[3] + off));
+        transpose_4x4_sse(k0, k1, k2, k3);
+        if (decrypt) {
+            sm4_4rounds_sse(x0, x1, x2, x3, k3, k2, k1, k0);
+        }
+        else {
+            sm4_4rounds_sse(x0, x1, x2, x3, k0, k1, k2, k3);
+        }
+    }
+    sm4_store4_sse(output, x0, x1, x2, x3);
+}
+
+template <bool VAES>
+SM4_TARGET_AVX2 static inline __m256i sm4_Tkey_avx2(__m256i x) {
+    x = sm4_sbox_avx2<VAES>(x);
+    __m256i r13 = _mm256_or_si256(_mm256_slli_epi32(x, 13), _mm256_srli_epi32(x, 19));
+    __m256i r23 = _mm256_or_si256(_mm256_slli_epi32(x, 23), _mm256_srli_epi32(x, 9));
+    return _mm256_xor_si256(x, _mm256_xor_si256(r13, r23));
+}
+
+// 两个128位通道分别写回：低通道为密钥lo，高通道为密钥lo+1
+SM4_TARGET_AVX2 static inline void store_lanes_avx2(uint32_t* lo, uint32_t* hi, __m256i x) {
+    _mm_storeu_si128((__m128i*)lo, _mm256_castsi256_si128(x));
+    _mm_storeu_si128((__m128i*)hi, _mm256_extracti128_si256(x, 1));
+}
+
+// 16个密钥并行扩展
+template <bool VAES>
+SM4_TARGET_AVX2 static inline void sm4_keygen16_avx2(uint32_t (*rks)[32], const uint8_t* keys) {
+    __m256i K[2][4];
+    for (int g = 0; g < 2; ++g) {
+        sm4_load8_avx2(keys + g * 128, K[g][0], K[g][1], K[g][2], K[g][3]);
+        for (int w = 0; w < 4; ++w) {
+            K[g][w] = _mm256_xor_si256(K[g][w], _mm256_set1_epi32(FK[w]));
+        }
+    }
+    for (int i = 0; i < 32; i += 4) {
+        for (int j = 0; j < 4; ++j) {
+            const __m256i ck = _mm256_set1_epi32(CK[i + j]);
+            for (int g = 0; g < 2; ++g) {
+                __m256i t = _mm256_xor_si256(_mm256_xor_si256(K[g][(j + 1) & 3], K[g][(j + 2) & 3]), _mm256_xor_si256(K[g][(j + 3) & 3], ck));
+                K[g][j] = _mm256_xor_si256(K[g][j], sm4_Tkey_avx2<VAES>(t));
+            }
+        }
+        for (int g = 0; g < 2; ++g) {
+            __m256i r0 = K[g][0], r1 = K[g][1], r2 = K[g][2], r3 = K[g][3];
+            transpose_4x4_avx2(r0, r1, r2, r3);
+            uint32_t (*out)[32] = rks + g * 8;
+            store_lanes_avx2(out[0] + i, out[1] + i, r0);
+            store_lanes_avx2(out[2] + i, out[3] + i, r1);
+            store_lanes_avx2(out[4] + i, out[5] + i, r2);
+            store_lanes_avx2(out[6] + i, out[7] + i, r3);
+        }
+    }
+}
+
+SM4_TARGET_AVX2 SM4_FLATTEN void RoundKeyGen16_avx2(uint32_t (*rks)[32], const uint8_t* keys) {
+    sm4_keygen16_avx2<false>(rks, keys);
+}
+
+SM4_TARGET_VAES SM4_FLATTEN void RoundKeyGen16_vaes(uint32_t (*rks)[32], const uint8_t* keys) {
+    sm4_keygen16_avx2<true>(rks, keys);
+}
+
+// 8个分组各用一把密钥加密
+template <bool VAES>
+SM4_TARGET_AVX2 static inline void sm4_encrypt8_multikey_avx2(const uint8_t* input, uint8_t* output, const uint32_t (*rks)[32], bool decrypt) {
+    __m256i x0, x1, x2, x3;
+    sm4_load8_avx2(input, x0, x1, x2, x3);
+    for (int i = 0; i < 32; i += 4) {
+        // 通道布局与sm4_load8_avx2一致：低通道对应分组0,2,4,6，高通道对应分组1,3,5,7
+        int off = decrypt ? 28 - i : i;
+        __m256i k0 = _mm256_loadu2_m128i((const __m128i*)(rks[1] + off), (const __m128i*)(rks[0] + off));
+        __m256i k1 = _mm256_loadu2_m128i((const __m128i*)(rks[3] + off), (const __m128i*)(rks[2] + off));
+        __m256i k2 = _mm256_loadu2_m128i((const __m128i*)(rks[5] + off), (const __m128i*)(rks[4] + off));
+        __m256i k3 = _mm256_loadu2_m128i((const __m128i*)(rks[7] + off), (const __m128i*)(rks[6] + off));
+        transpose_4x4_avx2(k0, k1, k2, k3);
+        if (decrypt) {
+            sm4_4rounds_avx2<VAES>(x0, x1, x2, x3, k3, k2, k1, k0);
+        }
+        else {
+            sm4_4rounds_avx2<VAES>(x0, x1, x2, x3, k0, k1, k2, k3);
+        }
+    }
+    sm4_store8_avx2(output, x0, x1, x2, x3);
+}
+
+SM4_TARGET_AVX2 SM4_FLATTEN void SM4Encrypt8_multikey_avx2(const uint8_t* input, uint8_t* output, const uint32_t (*rks)[32], bool decrypt) {
+    sm4_encrypt8_multikey_avx2<false>(input, output, rks, decrypt);
+}
+
+SM4_TARGET_VAES SM4_FLATTEN void SM4Encrypt8_multikey_vaes(const uint8_t* input, uint8_t* output, const uint32_t (*rks)[32], bool decrypt) {
+    sm4_encrypt8_multikey_avx2<true>(input, output, rks, decrypt);
+}
+
+// 各后端的批量密钥扩展：16/8个密钥一组走SIMD路径，剩余密钥逐个扩展
+static void sm4_keygen_scalar(uint32_t (*rks)[32], const uint8_t* keys, size_t nkeys) {
+    for (size_t i = 0; i < nkeys; ++i) {
+        RoundKeyGen(rks[i], keys + i * 16);
+    }
+}
+
+static void sm4_keygen_aesni(uint32_t (*rks)[32], const uint8_t* keys, size_t nkeys) {
+    size_t i = 0;
+    for (; i + 8 <= nkeys; i += 8) {
+        RoundKeyGen8_aesni(rks + i, keys + i * 16);
+    }
+    sm4_keygen_scalar(rks + i, keys + i * 16, nkeys - i);
+}
+
+static void sm4_keygen_avx2(uint32_t (*rks)[32], const uint8_t* keys, size_t nkeys) {
+    size_t i = 0;
+    for (; i + 16 <= nkeys; i += 16) {
+        RoundKeyGen16_avx2(rks + i, keys + i * 16);
+    }
+    sm4_keygen_aesni(rks + i, keys + i * 16, nkeys - i);
+}
+
+static void sm4_keygen_vaes(uint32_t (*rks)[32], const uint8_t* keys, size_t nkeys) {
+    size_t i = 0;
+    for (; i + 16 <= nkeys; i += 16) {
+        RoundKeyGen16_vaes(rks + i, keys + i * 16);
+    }
+    sm4_keygen_aesni(rks + i, keys + i * 16, nkeys - i);
+}
+
+// 各后端的多密钥加密：第j个分组使用rks[j]
+static void sm4_multikey_scalar(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t (*rks)[32], bool decrypt) {
+    for (size_t i = 0; i < nblocks; ++i) {
+        if (decrypt) {
+            uint32_t decrypt_rk[32];
+            for (int r = 0; r < 32; ++r) {
+                decrypt_rk[r] = rks[i][31 - r];
+            }
+            SM4Encrypt_optimized(input + i * 16, output + i * 16, decrypt_rk);
+        }
+        else {
+            SM4Encrypt_optimized(input + i * 16, output + i * 16, rks[i]);
+        }
+    }
+}
+
+static void sm4_multikey_aesni(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t (*rks)[32], bool decrypt) {
+    size_t i = 0;
+    for (; i + 4 <= nblocks; i += 4) {
+        SM4Encrypt4_multikey_aesni(input + i * 16, output + i * 16, rks + i, decrypt);
+    }
+    sm4_multikey_scalar(input + i * 16, output + i * 16, nblocks - i, rks + i, decrypt);
+}
+
+static void sm4_multikey_avx2(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t (*rks)[32], bool decrypt) {
+    size_t i = 0;
+    for (; i + 8 <= nblocks; i += 8) {
+        SM4Encrypt8_multikey_avx2(input + i * 16, output + i * 16, rks + i, decrypt);
+    }
+    sm4_multikey_aesni(input + i * 16, output + i * 16, nblocks - i, rks + i, decrypt);
+}
+
+static void sm4_multikey_vaes(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t (*rks)[32], bool decrypt) {
+    size_t i = 0;
+    for (; i + 8 <= nblocks; i += 8) {
+        SM4Encrypt8_multikey_vaes(input + i * 16, output + i * 16, rks + i, decrypt);
+    }
+    sm4_multikey_aesni(input + i * 16, output + i * 16, nblocks - i, rks + i, decrypt);
+}
+
+
+
+// 比特切片(bitsliced)常数时间实现
+// 128(SSE2)/256(AVX2)个分组转置为128个比特平面：平面 w*32+j 存放所有分组第w个字的第j位，
+// 寄存器的第b位对应第b个分组。S盒用布尔电路计算，线性变换L只是平面下标的循环移位，
+// 32轮中没有依赖数据的查表和分支，可抵御缓存计时攻击。
+// S盒电路：SM4_Sbox(x) = Mout * inv(Min * x + 0x01) + 0xd3，inv为复合域GF((2^4)^2)上的求逆
+// (GF(2^4)模x^4+x+1，GF(2^8) = GF(2^4)[y]/(y^2+y+8))，矩阵由与AES S盒的同构关系推出。
+// 电路模板不带target属性，AVX2版本在SM4Encrypt_bitsliced256中用flatten整体内联后按AVX2编译。
+// 模板内部的__m256i值只在内联后的AVX2代码中传递，GCC关于ABI变化的提示可以忽略。
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+static inline __m128i bs_xor(__m128i a, __m128i b) { return _mm_xor_si128(a, b); }
+static inline __m128i bs_and(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+template <typename V> V bs_set1(int32_t x);
+template <> inline __m128i bs_set1<__m128i>(int32_t x) { return _mm_set1_epi32(x); }
+SM4_TARGET("avx2") static inline __m256i bs_xor(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+SM4_TARGET("avx2") static inline __m256i bs_and(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+template <> SM4_TARGET("avx2") inline __m256i bs_set1<__m256i>(int32_t x) { return _mm256_set1_epi32(x); }
+
+// GF(2^4)乘法，模x^4+x+1
+template <typename V>
+static inline void gf16_mul_bs(V r[4], const V a[4], const V b[4]) {
+    V c0 = bs_and(a[0], b[0]);
+    V c1 = bs_xor(bs_and(a[0], b[1]), bs_and(a[1], b[0]));
+    V c2 = bs_xor(bs_xor(bs_and(a[0], b[2]), bs_and(a[1], b[1])), bs_and(a[2], b[0]));
+    V c3 = bs_xor(bs_xor(bs_and(a[0], b[3]), bs_and(a[1], b[2])), bs_xor(bs_and(a[2], b[1]), bs_and(a[3], b[0])));
+    V c4 = bs_xor(bs_xor(bs_and(a[1], b[3]), bs_and(a[2], b[2])), bs_and(a[3], b[1]));
+    V c5 = bs_xor(bs_and(a[2], b[3]), bs_and(a[3], b[2]));
+    V c6 = bs_and(a[3], b[3]);
+    r[0] = bs_xor(c0, c4);
+    r[1] = bs_xor(c1, bs_xor(c4, c5));
+    r[2] = bs_xor(c2, bs_xor(c5, c6));
+    r[3] = bs_xor(c3, c6);
+}
+
+// GF(2^4)求逆(0映射为0)，代数正规形
+template <typename V>
+static inline void gf16_inv_bs(V r[4], const V a[4]) {
+    V a01 = bs_and(a[0], a[1]), a02 = bs_and(a[0], a[2]), a03 = bs_and(a[0], a[3]);
+    V a12 = bs_and(a[1], a[2]), a13 = bs_and(a[1], a[3]), a23 = bs_and(a[2], a[3]);
+    V a012 = bs_and(a01, a[2]), a013 = bs_and(a01, a[3]), a023 = bs_and(a02, a[3]), a123 = bs_and(a12, a[3]);
+    r[0] = bs_xor(bs_xor(bs_xor(a[0], a[1]), bs_xor(a[2], a[3])), bs_xor(bs_xor(a02, a12), bs_xor(a012, a123)));
+    r[1] = bs_xor(bs_xor(bs_xor(a01, a02), bs_xor(a12, a[3])), bs_xor(a13, a013));
+    r[2] = bs_xor(bs_xor(bs_xor(a01, a[2]), bs_xor(a02, a[3])), bs_xor(a03, a023));
+    r[3] = bs_xor(bs_xor(bs_xor(a[1], a[2]), bs_xor(a[3], a03)), bs_xor(bs_xor(a13, a23), a123));
+}
+
+// 对8个比特平面(x[0]为最低位)原地计算SM4 S盒
+template <typename V>
+static inline void sm4_sbox_bs(V x[8]) {
+    const V ones = bs_set1<V>(-1);
+
+    // 输入变换：y = Min * x + 0x01，低4位为al，高4位为ah
+    V al[4], ah[4];
+    al[0] = bs_xor(bs_xor(x[2], x[5]), bs_xor(x[6], ones));
+    al[1] = bs_xor(bs_xor(x[0], x[2]), x[3]);
+    al[2] = bs_xor(bs_xor(bs_xor(x[0], x[1]), bs_xor(x[3], x[6])), x[7]);
+    al[3] = bs_xor(bs_xor(bs_xor(x[1], x[3]), bs_xor(x[5], x[6])), x[7]);
+    ah[0] = bs_xor(bs_xor(x[1], x[4]), bs_xor(x[5], x[7]));
+    ah[1] = bs_xor(bs_xor(x[0], x[1]), bs_xor(x[3], x[5]));
+    ah[2] = bs_xor(bs_xor(bs_xor(x[0], x[1]), bs_xor(x[2], x[3])), bs_xor(x[5], x[6]));
+    ah[3] = x[1];
+
+    // d = 8*ah^2 + ah*al + al^2
+    V d[4];
+    gf16_mul_bs(d, ah, al);
+    d[0] = bs_xor(d[0], bs_xor(bs_xor(al[0], al[2]), ah[2]));
+    d[1] = bs_xor(d[1], bs_xor(bs_xor(al[2], ah[1]), bs_xor(ah[2], ah[3])));
+    d[2] = bs_xor(d[2], bs_xor(bs_xor(al[1], al[3]), ah[1]));
+    d[3] = bs_xor(d[3], bs_xor(bs_xor(al[3], ah[0]), bs_xor(ah[2], ah[3])));
+
+    // (ah*y + al)^-1 = (ah*d^-1)*y + (ah+al)*d^-1
+    V e[4], s[4], zl[4], zh[4];
+    gf16_inv_bs(e, d);
+    for (int i = 0; i < 4; ++i) {
+        s[i] = bs_xor(ah[i], al[i]);
+    }
+    gf16_mul_bs(zh, ah, e);
+    gf16_mul_bs(zl, s, e);
+
+    // 输出变换：Mout * z + 0xd3
+    x[0] = bs_xor(bs_xor(zl[0], zl[1]), bs_xor(zl[2], ones));
+    x[1] = bs_xor(bs_xor(zl[2], zh[1]), bs_xor(zh[3], ones));
+    x[2] = bs_xor(bs_xor(zl[0], zl[1]), bs_xor(zh[1], zh[2]));
+    x[3] = zh[0];
+    x[4] = bs_xor(bs_xor(bs_xor(zl[2], zh[1]), bs_xor(zh[2], zh[3])), ones);
+    x[5] = bs_xor(bs_xor(bs_xor(zl[1], zl[2]), bs_xor(zl[3], zh[0])), bs_xor(zh[2], zh[3]));
+    x[6] = bs_xor(bs_xor(zl[1], zh[3]), ones);
+    x[7] = bs_xor(bs_xor(zh[0], zh[1]), bs_xor(zh[2], ones));
+}
+
+// 32轮比特切片加密，st[w*32+j]为第w个字的第j位平面
+// 结束时x32..x35依次位于第0..3个字的位置
+template <typename V>
+static void sm4_rounds_bs(V st[128], const uint32_t rk[32]) {
+    for (int i = 0; i < 32; ++i) {
+        V* x0 = st + (i & 3) * 32;
+        const V* x1 = st + ((i + 1) & 3) * 32;
+        const V* x2 = st + ((i + 2) & 3) * 32;
+        const V* x3 = st + ((i + 3) & 3) * 32;
+
+        // 轮密钥按位扩展为全0/全1平面，不按密钥分支
+        V t[32];
+        for (int j = 0; j < 32; ++j) {
+            V k = bs_set1<V>(-(int32_t)((rk[i] >> j) & 1));
+            t[j] = bs_xor(bs_xor(x1[j], x2[j]), bs_xor(x3[j], k));
+        }
+        for (int b = 0; b < 4; ++b) {
+            sm4_sbox_bs(t + b * 8);
+        }
+        // L: 循环左移r位即平面下标加r
+        for (int j = 0; j < 32; ++j) {
+            V l = bs_xor(bs_xor(t[j], t[(j + 30) & 31]), bs_xor(t[(j + 22) & 31], t[(j + 14) & 31]));
+            x0[j] = bs_xor(x0[j], bs_xor(l, t[(j + 8) & 31]));
+        }
+    }
+}
+
+// 16x16字节矩阵转置
+static inline void transpose_16x16_bytes(__m128i r[16]) {
+    for (int stage = 0; stage < 4; ++stage) {
+        __m128i t[16];
+        for (int i = 0; i < 8; ++i) {
+            t[2 * i] = _mm_unpacklo_epi8(r[i], r[i + 8]);
+            t[2 * i + 1] = _mm_unpackhi_epi8(r[i], r[i + 8]);
+        }
+        for (int i = 0; i < 16; ++i) {
+            r[i] = t[i];
+        }
+    }
+}
+
+// 16位掩码展开为16个字节(对应位为1的字节为0xFF)
+static inline __m128i expand_mask16(uint16_t m) {
+    const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    __m128i x = _mm_cvtsi32_si128(m);
+    x = _mm_unpacklo_epi8(x, x);
+    x = _mm_unpacklo_epi16(x, x);
+    x = _mm_unpacklo_epi32(x, x); // 低8字节为m的低字节，高8字节为m的高字节
+    return _mm_cmpeq_epi8(_mm_and_si128(x, bits), bits);
+}
+
+// 转置输入：每16个分组一组，planes[p * groups + g]为平面p中第g组的16位
+static void bitslice_transpose_in(const uint8_t* input, uint16_t* planes, int groups) {
+    for (int g = 0; g < groups; ++g) {
+        __m128i r[16];
+        for (int k = 0; k < 16; ++k) {
+            r[k] = _mm_loadu_si128((const __m128i*)(input + (g * 16 + k) * 16));
+        }
+        transpose_16x16_bytes(r); // r[p]的第k字节为第k个分组的第p字节
+        for (int p = 0; p < 16; ++p) {
+            int base = (p / 4) * 32 + 8 * (3 - p % 4); // 大端字内的位置
+            __m128i v = r[p];
+            for (int bit = 7; bit >= 0; --bit) {
+                planes[(base + bit) * groups + g] = (uint16_t)_mm_movemask_epi8(v);
+                v = _mm_add_epi8(v, v);
+            }
+        }
+    }
+}
+
+// 转置输出，同时完成反序变换(x35, x34, x33, x32)
+static void bitslice_transpose_out(const uint16_t* planes, uint8_t* output, int groups) {
+    for (int g = 0; g < groups; ++g) {
+        __m128i r[16];
+        for (int p = 0; p < 16; ++p) {
+            int base = (3 - p / 4) * 32 + 8 * (3 - p % 4);
+            __m128i v = _mm_setzero_si128();
+            for (int bit = 0; bit < 8; ++bit) {
+                __m128i m = expand_mask16(planes[(base + bit) * groups + g]);
+                v = _mm_or_si128(v, _mm_and_si128(m, _mm_set1_epi8((char)(1 << bit))));
+            }
+            r[p] = v;
+        }
+        transpose_16x16_bytes(r);
+        for (int k = 0; k < 16; ++k) {
+            _mm_storeu_si128((__m128i*)(output + (g * 16 + k) * 16), r[k]);
+        }
+    }
+}
+
+// 128分组比特切片加密(SSE2)
+void SM4Encrypt_bitsliced128(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    alignas(16) uint16_t planes[128][8];
+    __m128i st[128];
+    bitslice_transpose_in(input, &planes[0][0], 8);
+    for (int p = 0; p < 128; ++p) {
+        st[p] = _mm_load_si128((const __m128i*)planes[p]);
+    }
+    sm4_rounds_bs(st, rk);
+    for (int p = 0; p < 128; ++p) {
+        _mm_store_si128((__m128i*)planes[p], st[p]);
+    }
+    bitslice_transpose_out(&planes[0][0], output, 8);
+}
+
+// 256分组比特切片加密(AVX2)
+SM4_TARGET("avx2") SM4_FLATTEN void SM4Encrypt_bitsliced256(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
+    alignas(32) uint16_t planes[128][16];
+    __m256i st[128];
+    bitslice_transpose_in(input, &planes[0][0], 16);
+    for (int p = 0; p < 128; ++p) {
+        st[p] = _mm256_load_si256((const __m256i*)planes[p]);
+    }
+    sm4_rounds_bs(st, rk);
+    for (int p = 0; p < 128; ++p) {
+        _mm256_store_si256((__m256i*)planes[p], st[p]);
+    }
+    bitslice_transpose_out(&planes[0][0], output, 16);
+}
+
+// 比特切片批量加密(ECB)：轮密钥与SM4Encrypt_optimized相同
+// 不足128个分组的尾部补齐后同样走比特切片路径，保持常数时间
+static void sm4_bitsliced_sse2(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    size_t i = 0;
+    for (; i + 128 <= nblocks; i += 128) {
+        SM4Encrypt_bitsliced128(input + i * 16, output + i * 16, rk);
+    }
+    if (i < nblocks) {
+        uint8_t tail[128 * 16] = { 0 };
+        size_t tail_len = (nblocks - i) * 16;
+        memcpy(tail, input + i * 16, tail_len);
+        SM4Encrypt_bitsliced128(tail, tail, rk);
+        memcpy(output + i * 16, tail, tail_len);
+    }
+}
+
+static void sm4_bitsliced_avx2(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    size_t i = 0;
+    for (; i + 256 <= nblocks; i += 256) {
+        SM4Encrypt_bitsliced256(input + i * 16, output + i * 16, rk);
+    }
+    sm4_bitsliced_sse2(input + i * 16, output + i * 16, nblocks - i, rk);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+
+
+// 运行时后端分派
+// 启动时用cpuid检测CPU特性，把多分组加密、批量密钥扩展、多密钥加密和比特切片加密
+// 绑定到当前CPU支持的最快实现。环境变量SM4_BACKEND=scalar|aesni|avx2|vaes可强制指定后端，
+// 便于线上A/B测试，也可以在同一台机器上逐个测试每条路径。单分组加密各后端都用T-table。
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <cstdlib>
+
+struct CPUFeatures {
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool aesni = false;
+    bool pclmulqdq = false;
+    bool avx2 = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool vaes = false;
+    bool vpclmulqdq = false;
+};
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t r[4]) {
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuidex(regs, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i) {
+        r[i] = (uint32_t)regs[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// XCR0：操作系统是否在上下文切换时保存YMM/ZMM寄存器
+static uint64_t read_xcr0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static CPUFeatures detect_cpu_features() {
+    CPUFeatures f;
+    uint32_t r[4];
+    cpuid(0, 0, r);
+    const uint32_t max_leaf = r[0];
+
+    cpuid(1, 0, r);
+    f.pclmulqdq = (r[2] >> 1) & 1;
+    f.ssse3 = (r[2] >> 9) & 1;
+    f.sse41 = (r[2] >> 19) & 1;
+    f.aesni = (r[2] >> 25) & 1;
+    const bool osxsave = (r[2] >> 27) & 1;
+    const bool avx = (r[2] >> 28) & 1;
+    const uint64_t xcr0 = osxsave ? read_xcr0() : 0;
+    const bool ymm_enabled = avx && (xcr0 & 0x6) == 0x6;
+    const bool zmm_enabled = ymm_enabled && (xcr0 & 0xE0) == 0xE0;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, r);
+        f.avx2 = ymm_enabled && ((r[1] >> 5) & 1);
+        f.avx512f = zmm_enabled && ((r[1] >> 16) & 1);
+        f.avx512bw = zmm_enabled && ((r[1] >> 30) & 1);
+        f.vaes = ymm_enabled && ((r[2] >> 9) & 1);
+        f.vpclmulqdq = ymm_enabled && ((r[2] >> 10) & 1);
+    }
+    return f;
+}
+
+const CPUFeatures& cpu_features() {
+    static const CPUFeatures features = detect_cpu_features();
+    return features;
+}
+
+// 一个后端即一组实现，按优先级从高到低排列
+struct SM4Backend {
+    const char* name;
+    bool (*supported)(const CPUFeatures& f);
+    void (*encrypt_blocks)(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]);
+    void (*keygen_batch)(uint32_t (*rks)[32], const uint8_t* keys, size_t nkeys);
+    void (*encrypt_multikey)(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t (*rks)[32], bool decrypt);
+    void (*encrypt_bitsliced)(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]);
+};
+
+static const SM4Backend SM4_BACKENDS[] = {
+    { "vaes", [](const CPUFeatures& f) { return f.avx2 && f.aesni && f.vaes; },
+      sm4_blocks_vaes, sm4_keygen_vaes, sm4_multikey_vaes, sm4_bitsliced_avx2 },
+    { "avx2", [](const CPUFeatures& f) { return f.avx2 && f.aesni; },
+      sm4_blocks_avx2, sm4_keygen_avx2, sm4_multikey_avx2, sm4_bitsliced_avx2 },
+    { "aesni", [](const CPUFeatures& f) { return f.ssse3 && f.aesni; },
+      sm4_blocks_aesni, sm4_keygen_aesni, sm4_multikey_aesni, sm4_bitsliced_sse2 },
+    { "scalar", [](const CPUFeatures&) { return true; },
+      sm4_blocks_scalar, sm4_keygen_scalar, sm4_multikey_scalar, sm4_bitsliced_sse2 },
+};
+
+// 按名字查找当前CPU支持的后端；name为空或"auto"时返回最快的后端，找不到返回nullptr
+const SM4Backend* sm4_find_backend(const char* name) {
+    const bool best = name == nullptr || *name == '\0' || strcmp(name, "auto") == 0;
+    for (const SM4Backend& b : SM4_BACKENDS) {
+        if ((best || strcmp(name, b.name) == 0) && b.supported(cpu_features())) {
+            return &b;
+        }
+    }
+    return nullptr;
+}
+
+static const SM4Backend* select_sm4_backend() {
+    const char* forced = getenv("SM4_BACKEND");
+    const SM4Backend* b = sm4_find_backend(forced);
+    if (!b) {
+        std::cerr << "SM4_BACKEND=" << forced << " 不存在或当前CPU不支持，改用自动选择\n";
+        b = sm4_find_backend(nullptr);
+    }
+    return b;
+}
+
+static const SM4Backend* g_sm4_backend = select_sm4_backend();
+
+const SM4Backend& sm4_backend() { return *g_sm4_backend; }
+
+// 切换后端(用于测试)，不能与正在进行的加密并发调用
+bool sm4_set_backend(const char* name) {
+    const SM4Backend* b = sm4_find_backend(name);
+    if (b) {
+        g_sm4_backend = b;
+    }
+    return b != nullptr;
+}
+
+// 多分组加密(ECB)：轮密钥与SM4Encrypt_optimized相同，解密时传入逆序轮密钥
+void SM4Encrypt_blocks(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    g_sm4_backend->encrypt_blocks(input, output, nblocks, rk);
+}
+
+// 批量密钥扩展：keys为nkeys个连续的16字节密钥，rks[k]得到第k个密钥的轮密钥(与RoundKeyGen相同)
+void RoundKeyGen_batch(uint32_t (*rks)[32], const uint8_t* keys, size_t nkeys) {
+    g_sm4_backend->keygen_batch(rks, keys, nkeys);
+}
+
+// 多密钥加密：第j个分组使用rks[j]，例如每个租户一个分组；decrypt为true时做解密
+void SM4Encrypt_multikey(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t (*rks)[32], bool decrypt) {
+    g_sm4_backend->encrypt_multikey(input, output, nblocks, rks, decrypt);
+}
+
+// 比特切片批量加密(ECB)，常数时间
+void SM4Encrypt_bitsliced(const uint8_t* input, uint8_t* output, size_t nblocks, const uint32_t rk[32]) {
+    g_sm4_backend->encrypt_bitsliced(input, output, nblocks, rk);
+}
+
+
+
+
+// SM4密钥对象：构造时一次性扩展加密与解密轮密钥并按缓存行对齐保存，
+// 之后只读，可在多线程间共享，无需每次解密前再逆序轮密钥
+class SM4Key {
+public:
+    explicit SM4Key(const uint8_t key[16]) {
+        RoundKeyGen(enc_rk_, key);
+        for (int i = 0; i < 32; ++i) {
+            dec_rk_[i] = enc_rk_[31 - i];
+        }
+    }
+
+    ~SM4Key() {
+        // 清除轮密钥
+        volatile uint32_t* p = enc_rk_;
+        for (int i = 0; i < 32; ++i) p[i] = 0;
+        p = dec_rk_;
+        for (int i = 0; i < 32; ++i) p[i] = 0;
+    }
+
+    void encrypt_block(const uint8_t* input, uint8_t* output) const { SM4Encrypt_optimized(input, output, enc_rk_); }
+    void decrypt_block(const uint8_t* input, uint8_t* output) const { SM4Encrypt_optimized(input, output, dec_rk_); }
+
+    // 批量加解密，走多分组并行路径
+    void encrypt_blocks(const uint8_t* input, uint8_t* output, size_t nblocks) const { SM4Encrypt_blocks(input, output, nblocks, enc_rk_); }
+    void decrypt_blocks(const uint8_t* input, uint8_t* output, size_t nblocks) const { SM4Encrypt_blocks(input, output, nblocks, dec_rk_); }
+
+    // 批量加解密，走比特切片常数时间路径
+    void encrypt_blocks_ct(const uint8_t* input, uint8_t* output, size_t nblocks) const { SM4Encrypt_bitsliced(input, output, nblocks, enc_rk_); }
+    void decrypt_blocks_ct(const uint8_t* input, uint8_t* output, size_t nblocks) const { SM4Encrypt_bitsliced(input, output, nblocks, dec_rk_); }
+
+    const uint32_t* encrypt_rk() const { return enc_rk_; }
+    const uint32_t* decrypt_rk() const { return dec_rk_; }
+
+private:
+    alignas(64) uint32_t enc_rk_[32];
+    alignas(64) uint32_t dec_rk_[32];
+};
+
+
+// 分组工作模式 (CBC/CFB/OFB)
+// CBC、CFB加密与OFB的分组间存在串行依赖，只能逐块计算；CBC、CFB解密时每个分组所需的
+// 输入(密文)都已知，按MODE_CHUNK_BLOCKS个分组一批交给多分组实现。
+// 以下函数都支持原地处理(output == input)。
+constexpr size_t MODE_CHUNK_BLOCKS = 64;
+
+void xor_block(const uint8_t* a, const uint8_t* b, uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+// CBC加密，len需为16的倍数，否则返回false
+bool SM4Encrypt_CBC(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    if (len % 16 != 0) {
+        return false;
+    }
+    uint8_t block[16];
+    const uint8_t* prev = iv;
+    for (size_t i = 0; i < len; i += 16) {
+        xor_block(input + i, prev, block, 16);
+        key.encrypt_block(block, output + i);
+        prev = output + i;
+    }
+    return true;
+}
+
+// CBC解密，P_i = D(C_i) ^ C_{i-1}，D(C_i)批量并行计算
+bool SM4Decrypt_CBC(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    if (len % 16 != 0) {
+        return false;
+    }
+    uint8_t prev[16];
+    uint8_t next_prev[16];
+    uint8_t tmp[MODE_CHUNK_BLOCKS * 16];
+    memcpy(prev, iv, 16);
+    for (size_t i = 0; i < len; i += MODE_CHUNK_BLOCKS * 16) {
+        size_t chunk_len = (len - i) < MODE_CHUNK_BLOCKS * 16 ? (len - i) : MODE_CHUNK_BLOCKS * 16;
+        const uint8_t* in = input + i;
+        uint8_t* out = output + i;
+        key.decrypt_blocks(in, tmp, chunk_len / 16);
+        memcpy(next_prev, in + chunk_len - 16, 16);
+        // 从后往前写，原地处理时in[j - 16]在使用前不会被覆盖
+        for (size_t j = chunk_len - 16; j > 0; j -= 16) {
+            xor_block(tmp + j, in + j - 16, out + j, 16);
+        }
+        xor_block(tmp, prev, out, 16);
+        memcpy(prev, next_prev, 16);
+    }
+    return true;
+}
+
+// CFB加密(128位反馈)，任意长度
+void SM4Encrypt_CFB(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    uint8_t keystream[16];
+    const uint8_t* prev = iv;
+    for (size_t i = 0; i < len; i += 16) {
+        key.encrypt_block(prev, keystream);
+        size_t block_len = (len - i) < 16 ? (len - i) : 16;
+        xor_block(input + i, keystream, output + i, block_len);
+        prev = output + i;
+    }
+}
+
+// CFB解密，P_i = C_i ^ E(C_{i-1})，E(C_{i-1})批量并行计算
+void SM4Decrypt_CFB(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    uint8_t prev[16];
+    uint8_t ks_in[MODE_CHUNK_BLOCKS * 16];
+    uint8_t keystream[MODE_CHUNK_BLOCKS * 16];
+    memcpy(prev, iv, 16);
+    for (size_t i = 0; i < len; i += MODE_CHUNK_BLOCKS * 16) {
+        size_t chunk_len = (len - i) < MODE_CHUNK_BLOCKS * 16 ? (len - i) : MODE_CHUNK_BLOCKS * 16;
+        size_t nblocks = (chunk_len + 15) / 16;
+        // 密钥流输入为 C_{i-1}, C_i, ..., 即前一个密文分组加上本批除最后一个外的密文
+        memcpy(ks_in, prev, 16);
+        memcpy(ks_in + 16, input + i, (nblocks - 1) * 16);
+        key.encrypt_blocks(ks_in, keystream, nblocks);
+        if (chunk_len == nblocks * 16) {
+            memcpy(prev, input + i + chunk_len - 16, 16);
+        }
+        xor_block(input + i, keystream, output + i, chunk_len);
+    }
+}
+
+// OFB加解密(同一操作)，任意长度
+void SM4Crypt_OFB(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    uint8_t keystream[16];
+    memcpy(keystream, iv, 16);
+    for (size_t i = 0; i < len; i += 16) {
+        key.encrypt_block(keystream, keystream);
+        size_t block_len = (len - i) < 16 ? (len - i) : 16;
+        xor_block(input + i, keystream, output + i, block_len);
+    }
+}
+
+
+// 多线程ECB/CTR
+// 大缓冲区按固定大小切成任务，由线程池中的线程并行处理；CTR模式下每个任务
+// 根据自己的起始分组号计算计数器偏移，各任务之间没有共享的可变状态。
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// 固定大小的线程池，parallel_for把[0, ntasks)分给工作线程和调用线程执行
+class SM4ThreadPool {
+public:
+    explicit SM4ThreadPool(unsigned nthreads = std::thread::hardware_concurrency()) {
+        // 调用线程本身也参与计算，因此只需创建nthreads - 1个工作线程
+        for (unsigned i = 1; i < nthreads; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~SM4ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) {
+            t.join();
+        }
+    }
+
+    SM4ThreadPool(const SM4ThreadPool&) = delete;
+    SM4ThreadPool& operator=(const SM4ThreadPool&) = delete;
+
+    unsigned size() const { return (unsigned)workers_.size() + 1; }
+
+    // 返回时所有任务均已完成
+    void parallel_for(size_t ntasks, const std::function<void(size_t)>& fn) {
+        std::lock_guard<std::mutex> call_lk(call_mutex_);
+        if (workers_.empty() || ntasks <= 1) {
+            for (size_t i = 0; i < ntasks; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            job_ = &fn;
+            ntasks_ = ntasks;
+            next_.store(0);
+            active_ = workers_.size();
+            ++generation_;
+        }
+        cv_.notify_all();
+        run_tasks();
+        std::unique_lock<std::mutex> lk(mutex_);
+        done_cv_.wait(lk, [this] { return active_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    void run_tasks() {
+        for (size_t i = next_.fetch_add(1); i < ntasks_; i = next_.fetch_add(1)) {
+            (*job_)(i);
+        }
+    }
+
+    void worker_loop() {
+        uint64_t seen = 0;
+        for (;;) {
+            std::unique_lock<std::mutex> lk(mutex_);
+            cv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            lk.unlock();
+            run_tasks();
+            lk.lock();
+            if (--active_ == 0) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex call_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t ntasks_ = 0;
+    std::atomic<size_t> next_{ 0 };
+    size_t active_ = 0;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+// 每个任务处理的分组数 (64KB)，兼顾负载均衡与调度开销
+constexpr size_t PARALLEL_TASK_BLOCKS = 4096;
+
+// 128位大端计数器加n
+void ctr_add(uint8_t ctr[16], uint64_t n) {
+    uint64_t carry = n;
+    for (int i = 15; i >= 0 && carry != 0; --i) {
+        uint64_t sum = ctr[i] + (carry & 0xFF);
+        ctr[i] = (uint8_t)sum;
+        carry = (carry >> 8) + (sum >> 8);
+    }
+}
+
+// CTR加解密(同一操作)，计数器为128位大端整数，第k个分组使用iv + k
+// first_block为起始分组号，便于从流的中间位置开始处理
+void SM4Crypt_CTR(const SM4Key& key, const uint8_t iv[16], uint64_t first_block, const uint8_t* input, uint8_t* output, size_t len) {
+    uint8_t ctr[16];
+    uint8_t ctr_blocks[MODE_CHUNK_BLOCKS * 16];
+    uint8_t keystream[MODE_CHUNK_BLOCKS * 16];
+    memcpy(ctr, iv, 16);
+    ctr_add(ctr, first_block);
+    for (size_t i = 0; i < len; i += MODE_CHUNK_BLOCKS * 16) {
+        size_t chunk_len = (len - i) < MODE_CHUNK_BLOCKS * 16 ? (len - i) : MODE_CHUNK_BLOCKS * 16;
+        size_t nblocks = (chunk_len + 15) / 16;
+        for (size_t j = 0; j < nblocks; ++j) {
+            memcpy(ctr_blocks + j * 16, ctr, 16);
+            ctr_add(ctr, 1);
+        }
+        key.encrypt_blocks(ctr_blocks, keystream, nblocks);
+        xor_block(input + i, keystream, output + i, chunk_len);
+    }
+}
+
+// 多线程CTR：每个任务从自己的分组号开始计数
+void SM4Crypt_CTR_parallel(SM4ThreadPool& pool, const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    const size_t task_len = PARALLEL_TASK_BLOCKS * 16;
+    size_t ntasks = (len + task_len - 1) / task_len;
+    pool.parallel_for(ntasks, [&](size_t t) {
+        size_t offset = t * task_len;
+        size_t n = (len - offset) < task_len ? (len - offset) : task_len;
+        SM4Crypt_CTR(key, iv, (uint64_t)t * PARALLEL_TASK_BLOCKS, input + offset, output + offset, n);
+    });
+}
+
+// 多线程ECB，decrypt为true时使用解密轮密钥
+void SM4Crypt_ECB_parallel(SM4ThreadPool& pool, const SM4Key& key, const uint8_t* input, uint8_t* output, size_t nblocks, bool decrypt) {
+    size_t ntasks = (nblocks + PARALLEL_TASK_BLOCKS - 1) / PARALLEL_TASK_BLOCKS;
+    pool.parallel_for(ntasks, [&](size_t t) {
+        size_t first = t * PARALLEL_TASK_BLOCKS;
+        size_t n = (nblocks - first) < PARALLEL_TASK_BLOCKS ? (nblocks - first) : PARALLEL_TASK_BLOCKS;
+        if (decrypt) {
+            key.decrypt_blocks(input + first * 16, output + first * 16, n);
+        }
+        else {
+            key.encrypt_blocks(input + first * 16, output + first * 16, n);
+        }
+    });
+}
+// XTS模式 (IEEE 1619，分组密码为SM4)
+// 用于块设备/对象存储的按扇区加密：密钥为两个SM4密钥K1||K2，扇区号经K2加密得到初始tweak T0，
+// 扇区内第j个分组使用 T_j = T0 * alpha^j (GF(2^128)，小端约定)，C_j = E_K1(P_j ^ T_j) ^ T_j。
+// 扇区内所有分组互不依赖：先批量生成tweak并异或，再整扇区走多分组SIMD路径；
+// 多扇区接口再把扇区分组交给线程池。长度不是16的倍数时用密文挪用(ciphertext stealing)处理末尾。
+class SM4XTSKey {
+public:
+    // key为32字节：前16字节为数据密钥K1，后16字节为tweak密钥K2
+    explicit SM4XTSKey(const uint8_t key[32]) : data_key_(key), tweak_key_(key + 16) {}
+
+    const SM4Key& data_key() const { return data_key_; }
+    const SM4Key& tweak_key() const { return tweak_key_; }
+
+private:
+    SM4Key data_key_;
+    SM4Key tweak_key_;
+};
+
+// 小端128位tweak，lo为第0..7字节
+struct XTSTweak {
+    uint64_t lo;
+    uint64_t hi;
+};
+
+inline XTSTweak xts_load_tweak(const uint8_t t[16]) {
+    XTSTweak r = { 0, 0 };
+    for (int i = 0; i < 8; ++i) {
+        r.lo |= (uint64_t)t[i] << (8 * i);
+        r.hi |= (uint64_t)t[8 + i] << (8 * i);
+    }
+    return r;
+}
+
+inline void xts_store_tweak(const XTSTweak& t, uint8_t out[16]) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = (uint8_t)(t.lo >> (8 * i));
+        out[8 + i] = (uint8_t)(t.hi >> (8 * i));
+    }
+}
+
+// 乘以本原元alpha：整体左移1位，溢出时异或约化多项式x^128 + x^7 + x^2 + x + 1
+inline void xts_mul_alpha(XTSTweak& t) {
+    uint64_t carry = t.hi >> 63;
+    t.hi = (t.hi << 1) | (t.lo >> 63);
+    t.lo = (t.lo << 1) ^ (0x87 & (0 - carry));
+}
+
+// 单个数据单元(扇区)的XTS处理，t0为已用K2加密的初始tweak，len >= 16
+static void sm4_xts_unit(const SM4Key& key, const uint8_t t0[16], const uint8_t* input, uint8_t* output, size_t len, bool decrypt) {
+    const size_t nfull = len / 16;
+    const size_t tail = len % 16;
+    // 有不完整末尾时，最后一个完整分组参与密文挪用，单独处理
+    const size_t nbulk = tail ? nfull - 1 : nfull;
+    XTSTweak t = xts_load_tweak(t0);
+
+    uint8_t tweaks[MODE_CHUNK_BLOCKS * 16];
+    uint8_t buf[MODE_CHUNK_BLOCKS * 16];
+    for (size_t i = 0; i < nbulk; i += MODE_CHUNK_BLOCKS) {
+        size_t nblocks = (nbulk - i) < MODE_CHUNK_BLOCKS ? (nbulk - i) : MODE_CHUNK_BLOCKS;
+        for (size_t j = 0; j < nblocks; ++j) {
+            xts_store_tweak(t, tweaks + j * 16);
+            xts_mul_alpha(t);
+        }
+        xor_block(input + i * 16, tweaks, buf, nblocks * 16);
+        if (decrypt) {
+            key.decrypt_blocks(buf, buf, nblocks);
+        }
+        else {
+            key.encrypt_blocks(buf, buf, nblocks);
+        }
+        xor_block(buf, tweaks, output + i * 16, nblocks * 16);
+    }
+    if (!tail) {
+        return;
+    }
+
+    // 密文挪用：t此时为T_{m-1}，t_next为T_m
+    uint8_t tw_cur[16], tw_next[16], block[16];
+    XTSTweak t_next = t;
+    xts_mul_alpha(t_next);
+    xts_store_tweak(t, tw_cur);
+    xts_store_tweak(t_next, tw_next);
+    const uint8_t* in_last = input + nbulk * 16;
+    uint8_t* out_last = output + nbulk * 16;
+
+    // 加密时倒数第二个分组用T_{m-1}，解密时先用T_m还原
+    const uint8_t* first_tweak = decrypt ? tw_next : tw_cur;
+    const uint8_t* second_tweak = decrypt ? tw_cur : tw_next;
+    xor_block(in_last, first_tweak, block, 16);
+    if (decrypt) {
+        key.decrypt_block(block, block);
+    }
+    else {
+        key.encrypt_block(block, block);
+    }
+    xor_block(block, first_tweak, block, 16);
+
+    // block的前tail字节成为最后的不完整分组，不完整输入补上block剩余字节后再处理一次
+    uint8_t stolen[16];
+    memcpy(stolen, in_last + 16, tail);
+    memcpy(stolen + tail, block + tail, 16 - tail);
+    memcpy(out_last + 16, block, tail);
+    xor_block(stolen, second_tweak, block, 16);
+    if (decrypt) {
+        key.decrypt_block(block, block);
+    }
+    else {
+        key.encrypt_block(block, block);
+    }
+    xor_block(block, second_tweak, out_last, 16);
+}
+
+// 单个数据单元加解密，tweak为16字节原始tweak(通常为小端扇区号)，len至少16字节
+bool SM4Encrypt_XTS(const SM4XTSKey& key, const uint8_t tweak[16], const uint8_t* input, uint8_t* output, size_t len) {
+    if (len < 16) {
+        return false;
+    }
+    uint8_t t0[16];
+    key.tweak_key().encrypt_block(tweak, t0);
+    sm4_xts_unit(key.data_key(), t0, input, output, len, false);
+    return true;
+}
+
+bool SM4Decrypt_XTS(const SM4XTSKey& key, const uint8_t tweak[16], const uint8_t* input, uint8_t* output, size_t len) {
+    if (len < 16) {
+        return false;
+    }
+    uint8_t t0[16];
+    key.tweak_key().encrypt_block(tweak, t0);
+    sm4_xts_unit(key.data_key(), t0, input, output, len, true);
+    return true;
+}
+
+// 每个线程任务处理的扇区数上限(同时也是一次批量加密的初始tweak数)
+constexpr size_t XTS_TASK_SECTORS = 64;
+
+// 多扇区批量加解密：nsectors个连续扇区，第i个扇区的tweak为小端(first_sector + i)
+// 每个任务先用K2批量加密本组扇区的tweak，再逐扇区处理；pool为空时单线程
+static bool sm4_xts_sectors(const SM4XTSKey& key, uint64_t first_sector, const uint8_t* input, uint8_t* output, size_t nsectors, size_t sector_size, SM4ThreadPool* pool, bool decrypt) {
+    if (sector_size < 16) {
+        return false;
+    }
+    size_t ntasks = (nsectors + XTS_TASK_SECTORS - 1) / XTS_TASK_SECTORS;
+    auto task = [&](size_t t) {
+        size_t first = t * XTS_TASK_SECTORS;
+        size_t n = (nsectors - first) < XTS_TASK_SECTORS ? (nsectors - first) : XTS_TASK_SECTORS;
+        uint8_t t0[XTS_TASK_SECTORS * 16] = { 0 };
+        for (size_t i = 0; i < n; ++i) {
+            XTSTweak sector = { first_sector + first + i, 0 };
+            xts_store_tweak(sector, t0 + i * 16);
+        }
+        key.tweak_key().encrypt_blocks(t0, t0, n);
+        for (size_t i = 0; i < n; ++i) {
+            size_t offset = (first + i) * sector_size;
+            sm4_xts_unit(key.data_key(), t0 + i * 16, input + offset, output + offset, sector_size, decrypt);
+        }
+    };
+    if (pool) {
+        pool->parallel_for(ntasks, task);
+    }
+    else {
+        for (size_t t = 0; t < ntasks; ++t) {
+            task(t);
+        }
+    }
+    return true;
+}
+
+bool SM4Encrypt_XTS_sectors(const SM4XTSKey& key, uint64_t first_sector, const uint8_t* input, uint8_t* output, size_t nsectors, size_t sector_size, SM4ThreadPool* pool = nullptr) {
+    return sm4_xts_sectors(key, first_sector, input, output, nsectors, sector_size, pool, false);
+}
 
-// 初始化T-table
-void init_T_table() {
-    for (int i = 0; i < 256; ++i) {
-        uint8_t b = Sbox[i];
-        uint32_t word = b << 24; // 相当于b在最高字节位置
+bool SM4Decrypt_XTS_sectors(const SM4XTSKey& key, uint64_t first_sector, const uint8_t* input, uint8_t* output, size_t nsectors, size_t sector_size, SM4ThreadPool* pool = nullptr) {
+    return sm4_xts_sectors(key, first_sector, input, output, nsectors, sector_size, pool, true);
+}
 
-        // 线性变换L
-        uint32_t L = word
-            ^ ((word << 2) | (word >> 30))   // 循环左移2位
-            ^ ((word << 10) | (word >> 22))  // 循环左移10位
-            ^ ((word << 18) | (word >> 14))  // 循环左移18位
-            ^ ((word << 24) | (word >> 8));  // 循环左移24位
 
-        T_table[i] = L;
+// 文件流式CTR加解密
+// 任意大小的文件按窗口处理，内存占用与文件大小无关。
+// POSIX系统上用mmap把输入/输出窗口直接映射进地址空间，密文直接写入输出文件的页缓存，
+// 不经过额外的用户态缓冲区；处理当前窗口前对下一个窗口调用posix_fadvise(POSIX_FADV_WILLNEED)
+// (系统提供时)，让内核预读与加密计算重叠。其他平台或非普通文件(管道等)使用双缓冲读写：
+// 常驻的读线程读下一个窗口的同时，当前窗口原地加密后写出，每个字节只在用户态缓冲区停留一次。
+#include <cstdio>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SM4_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t FILE_STREAM_WINDOW = 8 * 1024 * 1024;  // 双缓冲每个缓冲区8MB
+constexpr size_t FILE_MMAP_WINDOW = 64 * 1024 * 1024;   // mmap每次映射64MB，为页大小整数倍
+
+// 窗口内的CTR处理：窗口起始分组号为first_block，pool为空时单线程
+static void sm4_ctr_window(const SM4Key& key, const uint8_t iv[16], uint64_t first_block, const uint8_t* input, uint8_t* output, size_t len, SM4ThreadPool* pool) {
+    if (pool) {
+        uint8_t window_iv[16];
+        memcpy(window_iv, iv, 16);
+        ctr_add(window_iv, first_block);
+        SM4Crypt_CTR_parallel(*pool, key, window_iv, input, output, len);
+    }
+    else {
+        SM4Crypt_CTR(key, iv, first_block, input, output, len);
     }
 }
 
-// 优化后的T_func使用T-table
-uint32_t T_func_optimized(uint32_t word) {
-    uint32_t result = 0;
-    result ^= T_table[(word >> 24) & 0xFF];
-    result ^= (T_table[(word >> 16) & 0xFF] >> 8) | (T_table[(word >> 16) & 0xFF] << 24);
-    result ^= (T_table[(word >> 8) & 0xFF] >> 16) | (T_table[(word >> 8) & 0xFF] << 16);
-    result ^= (T_table[word & 0xFF] >> 24) | (T_table[word & 0xFF] << 8);
-    return result;
+// 双缓冲流式CTR：in/out可以是普通文件、管道或标准输入输出
+// 整个流只启动一个读线程，交替填充两个缓冲区；主线程处理完一个缓冲区后交还给读线程
+bool SM4Crypt_CTR_stream(const SM4Key& key, const uint8_t iv[16], FILE* in, FILE* out, SM4ThreadPool* pool = nullptr) {
+    std::vector<uint8_t> buf[2] = { std::vector<uint8_t>(FILE_STREAM_WINDOW), std::vector<uint8_t>(FILE_STREAM_WINDOW) };
+    size_t got[2] = { 0, 0 };
+    bool full[2] = { false, false };
+    bool stop = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::thread reader([&] {
+        for (int slot = 0;; slot ^= 1) {
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+                cv.wait(lk, [&] { return stop || !full[slot]; });
+                if (stop) {
+                    return;
+                }
+            }
+            size_t n = fread(buf[slot].data(), 1, FILE_STREAM_WINDOW, in);
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                got[slot] = n;
+                full[slot] = true;
+            }
+            cv.notify_all();
+            // 只有读满一个窗口时才可能还有后续数据
+            if (n < FILE_STREAM_WINDOW) {
+                return;
+            }
+        }
+    });
+
+    uint64_t block = 0;
+    bool ok = true;
+    for (int cur = 0;; cur ^= 1) {
+        size_t len;
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return full[cur]; });
+            len = got[cur];
+        }
+        if (len == 0) {
+            break;
+        }
+        sm4_ctr_window(key, iv, block, buf[cur].data(), buf[cur].data(), len, pool);
+        ok = fwrite(buf[cur].data(), 1, len, out) == len;
+        if (!ok || len < FILE_STREAM_WINDOW) {
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            full[cur] = false;
+        }
+        cv.notify_all();
+        block += len / 16;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    reader.join();
+    return ok && !ferror(in) && fflush(out) == 0;
 }
 
-// 优化后的轮函数
-uint32_t SM4Round_optimized(uint32_t x1, uint32_t x2, uint32_t x3, uint32_t x4, uint32_t rk) {
-    return x1 ^ T_func_optimized(x2 ^ x3 ^ x4 ^ rk);
+static bool sm4_ctr_file_stdio(const SM4Key& key, const uint8_t iv[16], const char* in_path, const char* out_path, SM4ThreadPool* pool) {
+    FILE* in = fopen(in_path, "rb");
+    if (!in) {
+        return false;
+    }
+    FILE* out = fopen(out_path, "wb");
+    if (!out) {
+        fclose(in);
+        return false;
+    }
+    bool ok = SM4Crypt_CTR_stream(key, iv, in, out, pool);
+    fclose(in);
+    ok = (fclose(out) == 0) && ok;
+    return ok;
 }
 
-// 优化后的加密函数
-void SM4Encrypt_optimized(const uint8_t* input, uint8_t* output, const uint32_t rk[32]) {
-    // 初始化T-table (实际应用中只需初始化一次)
-    static bool table_initialized = false;
-    if (!table_initialized) {
-        init_T_table();
-        table_initialized = true;
+#ifdef SM4_HAS_MMAP
+// mmap路径：in_fd为普通文件，out_fd已扩展到size；in_fd == out_fd时原地处理
+static bool sm4_ctr_file_mmap(const SM4Key& key, const uint8_t iv[16], int in_fd, int out_fd, uint64_t size, SM4ThreadPool* pool) {
+    const bool in_place = in_fd == out_fd;
+    for (uint64_t offset = 0; offset < size; offset += FILE_MMAP_WINDOW) {
+        size_t len = (size - offset) < FILE_MMAP_WINDOW ? (size_t)(size - offset) : FILE_MMAP_WINDOW;
+        void* dst = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, (off_t)offset);
+        if (dst == MAP_FAILED) {
+            return false;
+        }
+        void* src = dst;
+        if (!in_place) {
+            src = mmap(nullptr, len, PROT_READ, MAP_SHARED, in_fd, (off_t)offset);
+            if (src == MAP_FAILED) {
+                munmap(dst, len);
+                return false;
+            }
+            madvise(src, len, MADV_SEQUENTIAL);
+        }
+        // 提前预读下一个窗口，与当前窗口的计算重叠(macOS没有posix_fadvise，只靠MADV_SEQUENTIAL)
+#ifdef POSIX_FADV_WILLNEED
+        uint64_t next = offset + len;
+        if (next < size) {
+            size_t next_len = (size - next) < FILE_MMAP_WINDOW ? (size_t)(size - next) : FILE_MMAP_WINDOW;
+            posix_fadvise(in_fd, (off_t)next, (off_t)next_len, POSIX_FADV_WILLNEED);
+        }
+#endif
+        sm4_ctr_window(key, iv, offset / 16, (const uint8_t*)src, (uint8_t*)dst, len, pool);
+        // 交给内核异步回写，已处理的窗口不再占用地址空间
+        msync(dst, len, MS_ASYNC);
+        if (!in_place) {
+            munmap(src, len);
+        }
+        munmap(dst, len);
     }
-
-    // 将输入转换为32位字 (大端序)
-    uint32_t x[36];
-    x[0] = (input[0] << 24) | (input[1] << 16) | (input[2] << 8) | input[3];
-    x[1] = (input[4] << 24) | (input[5] << 16) | (input[6] << 8) | input[7];
-    x[2] = (input[8] << 24) | (input[9] << 16) | (input[10] << 8) | input[11];
-    x[3] = (input[12] << 24) | (input[13] << 16) | (input[14] << 8) | input[15];
-
-    // 32轮加密 (部分展开)
-    for (int i = 0; i < 32; i += 4) {
-        x[i + 4] = SM4Round_optimized(x[i], x[i + 1], x[i + 2], x[i + 3], rk[i]);
-        x[i + 5] = SM4Round_optimized(x[i + 1], x[i + 2], x[i + 3], x[i + 4], rk[i + 1]);
-        x[i + 6] = SM4Round_optimized(x[i + 2], x[i + 3], x[i + 4], x[i + 5], rk[i + 2]);
-        x[i + 7] = SM4Round_optimized(x[i + 3], x[i + 4], x[i + 5], x[i + 6], rk[i + 3]);
+    return true;
+}
+#endif
+
+// 文件CTR加解密(同一操作)，POSIX系统上in_path与out_path可以相同(原地处理)
+// 成功返回true；失败时输出文件内容不确定
+bool SM4Crypt_CTR_file(const SM4Key& key, const uint8_t iv[16], const char* in_path, const char* out_path, SM4ThreadPool* pool = nullptr) {
+#ifdef SM4_HAS_MMAP
+    int in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0) {
+        return false;
     }
-
-    // 反序变换并输出
-    uint32_t out0 = x[35], out1 = x[34], out2 = x[33], out3 = x[32];
-    output[0] = (out0 >> 24) & 0xFF;
-    output[1] = (out0 >> 16) & 0xFF;
-    output[2] = (out0 >> 8) & 0xFF;
-    output[3] = out0 & 0xFF;
-    output[4] = (out1 >> 24) & 0xFF;
-    output[5] = (out1 >> 16) & 0xFF;
-    output[6] = (out1 >> 8) & 0xFF;
-    output[7] = out1 & 0xFF;
-    output[8] = (out2 >> 24) & 0xFF;
-    output[9] = (out2 >> 16) & 0xFF;
-    output[10] = (out2 >> 8) & 0xFF;
-    output[11] = out2 & 0xFF;
-    output[12] = (out3 >> 24) & 0xFF;
-    output[13] = (out3 >> 16) & 0xFF;
-    output[14] = (out3 >> 8) & 0xFF;
-    output[15] = out3 & 0xFF;
+    struct stat in_st;
+    if (fstat(in_fd, &in_st) != 0) {
+        close(in_fd);
+        return false;
+    }
+    // 管道、设备等无法映射，走双缓冲路径
+    if (!S_ISREG(in_st.st_mode)) {
+        close(in_fd);
+        return sm4_ctr_file_stdio(key, iv, in_path, out_path, pool);
+    }
+    const uint64_t size = (uint64_t)in_st.st_size;
+
+    // 输出同理：已存在的输出不是普通文件(/dev/null、FIFO等)时不能截断和映射
+    struct stat out_st;
+    const bool out_exists = stat(out_path, &out_st) == 0;
+    if (out_exists && !S_ISREG(out_st.st_mode)) {
+        close(in_fd);
+        return sm4_ctr_file_stdio(key, iv, in_path, out_path, pool);
+    }
+    bool same_file = out_exists && out_st.st_dev == in_st.st_dev && out_st.st_ino == in_st.st_ino;
+    int out_fd;
+    if (same_file) {
+        close(in_fd);
+        out_fd = in_fd = open(in_path, O_RDWR);
+    }
+    else {
+        out_fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    if (out_fd < 0) {
+        if (!same_file) {
+            close(in_fd);
+        }
+        return false;
+    }
+    bool ok = same_file || ftruncate(out_fd, (off_t)size) == 0;
+    ok = ok && sm4_ctr_file_mmap(key, iv, in_fd, out_fd, size, pool);
+    if (!same_file) {
+        close(in_fd);
+    }
+    ok = (close(out_fd) == 0) && ok;
+    return ok;
+#else
+    return sm4_ctr_file_stdio(key, iv, in_path, out_path, pool);
+#endif
 }
 
 
 
-
 // Benchmark Phase
 #include <chrono>
 #include <random>
@@ -265,9 +1792,10 @@ void benchmark_SM4() {
     constexpr int TEST_ITERATIONS = 10000;
     constexpr int BLOCK_SIZE = 16; // SM4块大小
 
-    // 准备测试数据
-    uint32_t rk[32];
-    RoundKeyGen(rk, Key);
+    // 准备测试数据 (加密/解密轮密钥一次扩展)
+    const SM4Key key(Key);
+    const uint32_t* rk = key.encrypt_rk();
+    const uint32_t* decrypt_rk = key.decrypt_rk();
 
     uint8_t plaintext[BLOCK_SIZE];
     uint8_t ciphertext[BLOCK_SIZE];
@@ -299,11 +1827,6 @@ void benchmark_SM4() {
     double avg_encrypt_ns = static_cast<double>(duration) / TEST_ITERATIONS;
 
     // 测试单次解密延迟
-    uint32_t decrypt_rk[32];
-    for (int i = 0; i < 32; ++i) {
-        decrypt_rk[i] = rk[31 - i];
-    }
-
     start = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < TEST_ITERATIONS; ++i) {
         SM4Encrypt(ciphertext, decrypted, decrypt_rk);
@@ -368,9 +1891,10 @@ void benchmark_SM4_opt() {
     constexpr int TEST_ITERATIONS = 10000;
     constexpr int BLOCK_SIZE = 16; // SM4块大小
 
-    // 准备测试数据
-    uint32_t rk[32];
-    RoundKeyGen(rk, Key);
+    // 准备测试数据 (加密/解密轮密钥一次扩展)
+    const SM4Key key(Key);
+    const uint32_t* rk = key.encrypt_rk();
+    const uint32_t* decrypt_rk = key.decrypt_rk();
 
     uint8_t plaintext[BLOCK_SIZE];
     uint8_t ciphertext[BLOCK_SIZE];
@@ -402,11 +1926,6 @@ void benchmark_SM4_opt() {
     double avg_encrypt_ns = static_cast<double>(duration) / TEST_ITERATIONS;
 
     // 测试单次解密延迟
-    uint32_t decrypt_rk[32];
-    for (int i = 0; i < 32; ++i) {
-        decrypt_rk[i] = rk[31 - i];
-    }
-
     start = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < TEST_ITERATIONS; ++i) {
         SM4Encrypt_optimized(ciphertext, decrypted, decrypt_rk);
@@ -461,13 +1980,741 @@ void benchmark_SM4_opt() {
 }
 
 
+// 多分组实现与单分组T-table实现对比验证
+bool verify_SM4_blocks() {
+    const SM4Key key(Key);
+    const uint32_t* rk = key.encrypt_rk();
+    const uint32_t* decrypt_rk = key.decrypt_rk();
+
+    constexpr size_t MAX_BLOCKS = 37; // 覆盖8/4分组路径及尾部
+    uint8_t plain[MAX_BLOCKS * 16];
+    uint8_t cipher_ref[MAX_BLOCKS * 16];
+    uint8_t cipher[MAX_BLOCKS * 16];
+    uint8_t decrypted[MAX_BLOCKS * 16];
+    generate_random_data(plain, sizeof(plain));
+
+    for (size_t n = 1; n <= MAX_BLOCKS; ++n) {
+        for (size_t i = 0; i < n; ++i) {
+            SM4Encrypt_optimized(plain + i * 16, cipher_ref + i * 16, rk);
+        }
+        SM4Encrypt_blocks(plain, cipher, n, rk);
+        SM4Encrypt_blocks(cipher, decrypted, n, decrypt_rk);
+        for (size_t i = 0; i < n * 16; ++i) {
+            if (cipher[i] != cipher_ref[i] || decrypted[i] != plain[i]) {
+                std::cout << "多分组实现与标量实现不一致 (分组数: " << std::dec << n << ")\n";
+                return false;
+            }
+        }
+    }
+    std::cout << "多分组实现与标量实现一致\n";
+    return true;
+}
+
+void benchmark_SM4_blocks() {
+    constexpr int BLOCK_SIZE = 16; // SM4块大小
+    constexpr int TEST_ITERATIONS = 16;
+
+    const SM4Key key(Key);
+    const uint32_t* rk = key.encrypt_rk();
+    const uint32_t* decrypt_rk = key.decrypt_rk();
+
+    constexpr size_t LARGE_BUFFER_SIZE = 1024 * 1024; // 1MB
+    uint8_t* large_plain = new uint8_t[LARGE_BUFFER_SIZE];
+    uint8_t* large_cipher = new uint8_t[LARGE_BUFFER_SIZE];
+    uint8_t* large_decrypted = new uint8_t[LARGE_BUFFER_SIZE];
+
+    generate_random_data(large_plain, LARGE_BUFFER_SIZE);
+    const size_t blocks = LARGE_BUFFER_SIZE / BLOCK_SIZE;
+
+    // 预热
+    SM4Encrypt_blocks(large_plain, large_cipher, blocks, rk);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TEST_ITERATIONS; ++i) {
+        SM4Encrypt_blocks(large_plain, large_cipher, blocks, rk);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double encrypt_throughput = (LARGE_BUFFER_SIZE * TEST_ITERATIONS / (1024.0 * 1024.0)) / (duration / 1000000.0);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TEST_ITERATIONS; ++i) {
+        SM4Encrypt_blocks(large_cipher, large_decrypted, blocks, decrypt_rk);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double decrypt_throughput = (LARGE_BUFFER_SIZE * TEST_ITERATIONS / (1024.0 * 1024.0)) / (duration / 1000000.0);
+
+    prevent_optimization ^= large_decrypted[0];
+
+    delete[] large_plain;
+    delete[] large_cipher;
+    delete[] large_decrypted;
+
+    std::cout << "===============================\n";
+    std::cout << "多分组并行性能测试 (后端: " << sm4_backend().name << "):\n\n";
+    std::cout << "吞吐量 (1MB数据):\n";
+    std::cout << "  加密: " << std::fixed << std::setprecision(2) << encrypt_throughput << " MB/s\n";
+    std::cout << "  解密: " << std::fixed << std::setprecision(2) << decrypt_throughput << " MB/s\n";
+}
+
+// 比特切片实现与单分组T-table实现对比验证
+bool verify_SM4_bitsliced() {
+    const SM4Key key(Key);
+    const uint32_t* rk = key.encrypt_rk();
+    const uint32_t* decrypt_rk = key.decrypt_rk();
+
+    const size_t counts[] = { 1, 127, 128, 129, 256, 300, 513 };
+    constexpr size_t MAX_BLOCKS = 513;
+    uint8_t* plain = new uint8_t[MAX_BLOCKS * 16];
+    uint8_t* cipher_ref = new uint8_t[MAX_BLOCKS * 16];
+    uint8_t* cipher = new uint8_t[MAX_BLOCKS * 16];
+    uint8_t* decrypted = new uint8_t[MAX_BLOCKS * 16];
+    generate_random_data(plain, MAX_BLOCKS * 16);
+
+    bool ok = true;
+    for (size_t n : counts) {
+        for (size_t i = 0; i < n; ++i) {
+            SM4Encrypt_optimized(plain + i * 16, cipher_ref + i * 16, rk);
+        }
+        SM4Encrypt_bitsliced(plain, cipher, n, rk);
+        SM4Encrypt_bitsliced(cipher, decrypted, n, decrypt_rk);
+        if (memcmp(cipher, cipher_ref, n * 16) != 0 || memcmp(decrypted, plain, n * 16) != 0) {
+            std::cout << "比特切片实现与标量实现不一致 (分组数: " << std::dec << n << ")\n";
+            ok = false;
+            break;
+        }
+    }
+    if (ok) {
+        std::cout << "比特切片实现与标量实现一致\n";
+    }
+
+    delete[] plain;
+    delete[] cipher_ref;
+    delete[] cipher;
+    delete[] decrypted;
+    return ok;
+}
+
+// 比特切片与T-table (benchmark_SM4_opt) 吞吐量对比
+void benchmark_SM4_bitsliced() {
+    constexpr int BLOCK_SIZE = 16; // SM4块大小
+    constexpr int TEST_ITERATIONS = 16;
+
+    const SM4Key key(Key);
+
+    constexpr size_t LARGE_BUFFER_SIZE = 1024 * 1024; // 1MB
+    uint8_t* large_plain = new uint8_t[LARGE_BUFFER_SIZE];
+    uint8_t* large_cipher = new uint8_t[LARGE_BUFFER_SIZE];
+
+    generate_random_data(large_plain, LARGE_BUFFER_SIZE);
+    const size_t blocks = LARGE_BUFFER_SIZE / BLOCK_SIZE;
+
+    // T-table逐块加密
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < TEST_ITERATIONS; ++it) {
+        for (size_t i = 0; i < blocks; ++i) {
+            key.encrypt_block(large_plain + i * BLOCK_SIZE, large_cipher + i * BLOCK_SIZE);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double table_throughput = (LARGE_BUFFER_SIZE * TEST_ITERATIONS / (1024.0 * 1024.0)) / (duration / 1000000.0);
+
+    // 比特切片批量加密
+    start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < TEST_ITERATIONS; ++it) {
+        key.encrypt_blocks_ct(large_plain, large_cipher, blocks);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double bitsliced_throughput = (LARGE_BUFFER_SIZE * TEST_ITERATIONS / (1024.0 * 1024.0)) / (duration / 1000000.0);
+
+    prevent_optimization ^= large_cipher[0];
+
+    delete[] large_plain;
+    delete[] large_cipher;
+
+    std::cout << "===============================\n";
+    std::cout << "比特切片性能测试 (后端: " << sm4_backend().name << "):\n\n";
+    std::cout << "加密吞吐量 (1MB数据):\n";
+    std::cout << "  T-table:  " << std::fixed << std::setprecision(2) << table_throughput << " MB/s\n";
+    std::cout << "  比特切片: " << std::fixed << std::setprecision(2) << bitsliced_throughput << " MB/s (";
+    std::cout << std::setprecision(1) << (bitsliced_throughput / table_throughput) << "x)\n";
+}
+
+// 批量密钥扩展与多密钥加密的正确性验证
+bool verify_SM4_multikey() {
+    constexpr size_t NKEYS = 45; // 覆盖16/8个密钥一组的路径及尾部
+    uint8_t keys[NKEYS * 16];
+    uint8_t plain[NKEYS * 16];
+    uint8_t cipher_ref[NKEYS * 16];
+    uint8_t cipher[NKEYS * 16];
+    uint8_t decrypted[NKEYS * 16];
+    uint32_t rk_ref[NKEYS][32];
+    uint32_t rks[NKEYS][32];
+    generate_random_data(keys, sizeof(keys));
+    generate_random_data(plain, sizeof(plain));
+
+    for (size_t k = 0; k < NKEYS; ++k) {
+        RoundKeyGen(rk_ref[k], keys + k * 16);
+        SM4Encrypt_optimized(plain + k * 16, cipher_ref + k * 16, rk_ref[k]);
+    }
+    RoundKeyGen_batch(rks, keys, NKEYS);
+    SM4Encrypt_multikey(plain, cipher, NKEYS, rks, false);
+    SM4Encrypt_multikey(cipher, decrypted, NKEYS, rks, true);
+
+    bool ok = memcmp(rks, rk_ref, sizeof(rks)) == 0 &&
+        memcmp(cipher, cipher_ref, sizeof(cipher)) == 0 &&
+        memcmp(decrypted, plain, sizeof(plain)) == 0;
+    std::cout << "批量密钥扩展/多密钥加密与标量实现" << (ok ? "一致" : "不一致") << "\n";
+    return ok;
+}
+
+// 密钥扩展性能：逐个RoundKeyGen与批量扩展对比
+void benchmark_SM4_keygen() {
+    constexpr size_t NKEYS = 4096;
+    constexpr int TEST_ITERATIONS = 16;
+    uint8_t* keys = new uint8_t[NKEYS * 16];
+    uint32_t (*rks)[32] = new uint32_t[NKEYS][32];
+    generate_random_data(keys, NKEYS * 16);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < TEST_ITERATIONS; ++it) {
+        for (size_t k = 0; k < NKEYS; ++k) {
+            RoundKeyGen(rks[k], keys + k * 16);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double single_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / double(NKEYS * TEST_ITERATIONS);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < TEST_ITERATIONS; ++it) {
+        RoundKeyGen_batch(rks, keys, NKEYS);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double batch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / double(NKEYS * TEST_ITERATIONS);
+
+    prevent_optimization ^= (uint8_t)rks[NKEYS - 1][31];
+    delete[] keys;
+    delete[] rks;
+
+    std::cout << "===============================\n";
+    std::cout << "密钥扩展性能测试 (每个密钥):\n\n";
+    std::cout << "  逐个扩展: " << std::fixed << std::setprecision(2) << single_ns << " ns\n";
+    std::cout << "  批量扩展: " << std::fixed << std::setprecision(2) << batch_ns << " ns (";
+    std::cout << std::setprecision(1) << (single_ns / batch_ns) << "x)\n";
+}
+
+// 逐块实现的CBC/CFB解密，作为并行解密的参照
+static void SM4Decrypt_CBC_serial(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    uint8_t prev[16], block[16];
+    memcpy(prev, iv, 16);
+    for (size_t i = 0; i < len; i += 16) {
+        key.decrypt_block(input + i, block);
+        xor_block(block, prev, block, 16);
+        memcpy(prev, input + i, 16);
+        memcpy(output + i, block, 16);
+    }
+}
+
+static void SM4Decrypt_CFB_serial(const SM4Key& key, const uint8_t iv[16], const uint8_t* input, uint8_t* output, size_t len) {
+    uint8_t prev[16], keystream[16];
+    memcpy(prev, iv, 16);
+    for (size_t i = 0; i < len; i += 16) {
+        key.encrypt_block(prev, keystream);
+        size_t block_len = (len - i) < 16 ? (len - i) : 16;
+        if (block_len == 16) {
+            memcpy(prev, input + i, 16);
+        }
+        xor_block(input + i, keystream, output + i, block_len);
+    }
+}
+
+// 工作模式正确性验证：并行解密与逐块解密一致，加解密往返及原地处理
+bool verify_SM4_modes() {
+    const SM4Key key(Key);
+    uint8_t iv[16];
+    generate_random_data(iv, 16);
+
+    constexpr size_t MAX_LEN = 4096 + 16 * 70;
+    uint8_t* plain = new uint8_t[MAX_LEN];
+    uint8_t* cipher = new uint8_t[MAX_LEN];
+    uint8_t* decrypted = new uint8_t[MAX_LEN];
+    uint8_t* reference = new uint8_t[MAX_LEN];
+    generate_random_data(plain, MAX_LEN);
+
+    bool ok = true;
+    const size_t cbc_lens[] = { 16, 160, 64 * 16, 64 * 16 + 48, MAX_LEN };
+    for (size_t len : cbc_lens) {
+        SM4Encrypt_CBC(key, iv, plain, cipher, len);
+        SM4Decrypt_CBC(key, iv, cipher, decrypted, len);
+        SM4Decrypt_CBC_serial(key, iv, cipher, reference, len);
+        ok = ok && memcmp(decrypted, plain, len) == 0 && memcmp(reference, plain, len) == 0;
+        memcpy(decrypted, cipher, len);
+        SM4Decrypt_CBC(key, iv, decrypted, decrypted, len); // 原地
+        ok = ok && memcmp(decrypted, plain, len) == 0;
+    }
+    ok = ok && !SM4Encrypt_CBC(key, iv, plain, cipher, 17);
+
+    const size_t stream_lens[] = { 1, 15, 17, 1000, 64 * 16 + 5, MAX_LEN };
+    for (size_t len : stream_lens) {
+        SM4Encrypt_CFB(key, iv, plain, cipher, len);
+        SM4Decrypt_CFB(key, iv, cipher, decrypted, len);
+        SM4Decrypt_CFB_serial(key, iv, cipher, reference, len);
+        ok = ok && memcmp(decrypted, plain, len) == 0 && memcmp(reference, plain, len) == 0;
+        memcpy(decrypted, cipher, len);
+        SM4Decrypt_CFB(key, iv, decrypted, decrypted, len); // 原地
+        ok = ok && memcmp(decrypted, plain, len) == 0;
+
+        SM4Crypt_OFB(key, iv, plain, cipher, len);
+        SM4Crypt_OFB(key, iv, cipher, decrypted, len);
+        ok = ok && memcmp(decrypted, plain, len) == 0;
+    }
+
+    // OFB密钥流等于CBC加密全零明文的结果
+    memset(plain, 0, 1024);
+    SM4Crypt_OFB(key, iv, plain, cipher, 1024);
+    SM4Encrypt_CBC(key, iv, plain, reference, 1024);
+    ok = ok && memcmp(cipher, reference, 1024) == 0;
+
+    std::cout << "CBC/CFB/OFB工作模式验证" << (ok ? "通过" : "失败") << "\n";
+
+    delete[] plain;
+    delete[] cipher;
+    delete[] decrypted;
+    delete[] reference;
+    return ok;
+}
+
+void benchmark_SM4_modes() {
+    constexpr size_t LARGE_BUFFER_SIZE = 1024 * 1024; // 1MB
+    constexpr int TEST_ITERATIONS = 8;
+    const SM4Key key(Key);
+    uint8_t iv[16] = { 0 };
+
+    uint8_t* large_plain = new uint8_t[LARGE_BUFFER_SIZE];
+    uint8_t* large_cipher = new uint8_t[LARGE_BUFFER_SIZE];
+    uint8_t* large_decrypted = new uint8_t[LARGE_BUFFER_SIZE];
+    generate_random_data(large_plain, LARGE_BUFFER_SIZE);
+
+    // 测量fn重复TEST_ITERATIONS次的吞吐量(MB/s)
+    auto measure = [&](auto fn) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int it = 0; it < TEST_ITERATIONS; ++it) {
+            fn();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        return (LARGE_BUFFER_SIZE * TEST_ITERATIONS / (1024.0 * 1024.0)) / (duration / 1000000.0);
+    };
+
+    double cbc_enc = measure([&] { SM4Encrypt_CBC(key, iv, large_plain, large_cipher, LARGE_BUFFER_SIZE); });
+    double cbc_dec_serial = measure([&] { SM4Decrypt_CBC_serial(key, iv, large_cipher, large_decrypted, LARGE_BUFFER_SIZE); });
+    double cbc_dec = measure([&] { SM4Decrypt_CBC(key, iv, large_cipher, large_decrypted, LARGE_BUFFER_SIZE); });
+    double cfb_enc = measure([&] { SM4Encrypt_CFB(key, iv, large_plain, large_cipher, LARGE_BUFFER_SIZE); });
+    double cfb_dec = measure([&] { SM4Decrypt_CFB(key, iv, large_cipher, large_decrypted, LARGE_BUFFER_SIZE); });
+    double ofb = measure([&] { SM4Crypt_OFB(key, iv, large_plain, large_cipher, LARGE_BUFFER_SIZE); });
+
+    prevent_optimization ^= large_decrypted[0];
+    delete[] large_plain;
+    delete[] large_cipher;
+    delete[] large_decrypted;
+
+    std::cout << "===============================\n";
+    std::cout << "工作模式吞吐量 (1MB数据):\n\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  CBC加密:          " << cbc_enc << " MB/s\n";
+    std::cout << "  CBC解密(逐块):    " << cbc_dec_serial << " MB/s\n";
+    std::cout << "  CBC解密(多分组):  " << cbc_dec << " MB/s\n";
+    std::cout << "  CFB加密:          " << cfb_enc << " MB/s\n";
+    std::cout << "  CFB解密(多分组):  " << cfb_dec << " MB/s\n";
+    std::cout << "  OFB:              " << ofb << " MB/s\n";
+}
+
+// 多线程ECB/CTR与单线程结果对比验证
+bool verify_SM4_parallel() {
+    const SM4Key key(Key);
+    uint8_t iv[16];
+    generate_random_data(iv, 16);
+    iv[15] = 0xF0; // 让计数器在任务内部产生进位
+
+    constexpr size_t LEN = PARALLEL_TASK_BLOCKS * 16 * 5 + 1000;
+    uint8_t* plain = new uint8_t[LEN];
+    uint8_t* reference = new uint8_t[LEN];
+    uint8_t* output = new uint8_t[LEN];
+    generate_random_data(plain, LEN);
+
+    SM4ThreadPool pool(4);
+    bool ok = true;
+
+    // 单线程CTR逐块参照：分组k的密钥流为E(iv + k)
+    uint8_t ctr[16], keystream[16];
+    memcpy(ctr, iv, 16);
+    for (size_t i = 0; i < LEN; i += 16) {
+        key.encrypt_block(ctr, keystream);
+        ctr_add(ctr, 1);
+        xor_block(plain + i, keystream, reference + i, (LEN - i) < 16 ? (LEN - i) : 16);
+    }
+    SM4Crypt_CTR_parallel(pool, key, iv, plain, output, LEN);
+    ok = ok && memcmp(output, reference, LEN) == 0;
+    SM4Crypt_CTR_parallel(pool, key, iv, output, output, LEN); // 原地解密
+    ok = ok && memcmp(output, plain, LEN) == 0;
+
+    const size_t nblocks = LEN / 16;
+    key.encrypt_blocks(plain, reference, nblocks);
+    SM4Crypt_ECB_parallel(pool, key, plain, output, nblocks, false);
+    ok = ok && memcmp(output, reference, nblocks * 16) == 0;
+    SM4Crypt_ECB_parallel(pool, key, reference, output, nblocks, true);
+    ok = ok && memcmp(output, plain, nblocks * 16) == 0;
+
+    std::cout << "多线程ECB/CTR与单线程结果" << (ok ? "一致" : "不一致") << "\n";
+
+    delete[] plain;
+    delete[] reference;
+    delete[] output;
+    return ok;
+}
+
+void benchmark_SM4_parallel() {
+    constexpr size_t LARGE_BUFFER_SIZE = 64 * 1024 * 1024; // 64MB
+    const SM4Key key(Key);
+    uint8_t iv[16] = { 0 };
+    uint8_t* large_plain = new uint8_t[LARGE_BUFFER_SIZE];
+    uint8_t* large_cipher = new uint8_t[LARGE_BUFFER_SIZE];
+    generate_random_data(large_plain, LARGE_BUFFER_SIZE);
+
+    SM4ThreadPool pool;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    SM4Crypt_CTR(key, iv, 0, large_plain, large_cipher, LARGE_BUFFER_SIZE);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double single_throughput = (LARGE_BUFFER_SIZE / (1024.0 * 1024.0)) / (duration / 1000000.0);
+
+    start = std::chrono::high_resolution_clock::now();
+    SM4Crypt_CTR_parallel(pool, key, iv, large_plain, large_cipher, LARGE_BUFFER_SIZE);
+    end = std::chrono::high_resolution_clock::now();
+    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double parallel_throughput = (LARGE_BUFFER_SIZE / (1024.0 * 1024.0)) / (duration / 1000000.0);
+
+    prevent_optimization ^= large_cipher[0];
+    delete[] large_plain;
+    delete[] large_cipher;
+
+    std::cout << "===============================\n";
+    std::cout << "多线程CTR性能测试 (64MB数据, " << std::dec << pool.size() << "线程):\n\n";
+    std::cout << "  单线程: " << std::fixed << std::setprecision(2) << single_throughput << " MB/s\n";
+    std::cout << "  多线程: " << std::fixed << std::setprecision(2) << parallel_throughput << " MB/s (";
+    std::cout << std::setprecision(1) << (parallel_throughput / single_throughput) << "x)\n";
+}
+
+// 逐字节计算tweak、逐分组加密的XTS参照实现，仅用于验证
+void SM4Encrypt_XTS_reference(const uint8_t key[32], const uint8_t tweak[16], const uint8_t* input, uint8_t* output, size_t len) {
+    const SM4Key k1(key), k2(key + 16);
+    uint8_t t[16], next[16], block[16];
+    k2.encrypt_block(tweak, t);
+    auto mul_alpha = [](uint8_t x[16]) {
+        uint8_t carry = x[15] >> 7;
+        for (int i = 15; i > 0; --i) {
+            x[i] = (uint8_t)((x[i] << 1) | (x[i - 1] >> 7));
+        }
+        x[0] = (uint8_t)((x[0] << 1) ^ (carry ? 0x87 : 0));
+    };
+    const size_t m = len / 16, tail = len % 16;
+    for (size_t j = 0; j < m; ++j) {
+        xor_block(input + j * 16, t, block, 16);
+        k1.encrypt_block(block, block);
+        xor_block(block, t, output + j * 16, 16);
+        mul_alpha(t);
+    }
+    if (tail) {
+        // 最后一个完整分组的密文前tail字节移到末尾，其余字节补足不完整明文后再加密
+        uint8_t* last = output + (m - 1) * 16;
+        memcpy(next, input + m * 16, tail);
+        memcpy(next + tail, last + tail, 16 - tail);
+        memcpy(output + m * 16, last, tail);
+        xor_block(next, t, block, 16);
+        k1.encrypt_block(block, block);
+        xor_block(block, t, last, 16);
+    }
+}
+
+bool verify_SM4_xts() {
+    uint8_t key_bytes[32];
+    generate_random_data(key_bytes, 32);
+    const SM4XTSKey key(key_bytes);
+    bool ok = true;
+
+    // 单数据单元：覆盖完整分组与各种不完整末尾
+    const size_t lens[] = { 16, 17, 31, 32, 47, 512, 520, 4096, 4111 };
+    std::vector<uint8_t> plain(4111), reference(4111), cipher(4111), decrypted(4111);
+    generate_random_data(plain.data(), plain.size());
+    uint8_t tweak[16];
+    generate_random_data(tweak, 16);
+    for (size_t len : lens) {
+        SM4Encrypt_XTS_reference(key_bytes, tweak, plain.data(), reference.data(), len);
+        ok = ok && SM4Encrypt_XTS(key, tweak, plain.data(), cipher.data(), len);
+        ok = ok && memcmp(cipher.data(), reference.data(), len) == 0;
+        ok = ok && SM4Decrypt_XTS(key, tweak, cipher.data(), cipher.data(), len); // 原地解密
+        ok = ok && memcmp(cipher.data(), plain.data(), len) == 0;
+    }
+    ok = ok && !SM4Encrypt_XTS(key, tweak, plain.data(), cipher.data(), 15);
+
+    // 多扇区批量接口与逐扇区单独处理一致
+    SM4ThreadPool pool(4);
+    const size_t sector_sizes[] = { 512, 4096, 528 };
+    for (size_t sector_size : sector_sizes) {
+        const size_t nsectors = XTS_TASK_SECTORS * 3 + 5;
+        const uint64_t first_sector = 0xFFFFFFF0ull;
+        std::vector<uint8_t> data(nsectors * sector_size), expect(data.size()), out(data.size());
+        generate_random_data(data.data(), data.size());
+        for (size_t i = 0; i < nsectors; ++i) {
+            uint8_t sector_tweak[16] = { 0 };
+            XTSTweak sector = { first_sector + i, 0 };
+            xts_store_tweak(sector, sector_tweak);
+            SM4Encrypt_XTS(key, sector_tweak, data.data() + i * sector_size, expect.data() + i * sector_size, sector_size);
+        }
+        ok = ok && SM4Encrypt_XTS_sectors(key, first_sector, data.data(), out.data(), nsectors, sector_size, &pool);
+        ok = ok && out == expect;
+        ok = ok && SM4Decrypt_XTS_sectors(key, first_sector, out.data(), out.data(), nsectors, sector_size);
+        ok = ok && out == data;
+    }
+
+    std::cout << "XTS模式验证" << (ok ? "通过" : "失败") << "\n";
+    return ok;
+}
+
+void benchmark_SM4_xts() {
+    constexpr size_t LARGE_BUFFER_SIZE = 64 * 1024 * 1024; // 64MB
+    uint8_t key_bytes[32];
+    generate_random_data(key_bytes, 32);
+    const SM4XTSKey key(key_bytes);
+    std::vector<uint8_t> plain(LARGE_BUFFER_SIZE), cipher(LARGE_BUFFER_SIZE);
+    generate_random_data(plain.data(), plain.size());
+    SM4ThreadPool pool;
+
+    auto measure = [&](size_t sector_size, SM4ThreadPool* p) {
+        auto start = std::chrono::high_resolution_clock::now();
+        SM4Encrypt_XTS_sectors(key, 0, plain.data(), cipher.data(), LARGE_BUFFER_SIZE / sector_size, sector_size, p);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        prevent_optimization ^= cipher[0];
+        return (LARGE_BUFFER_SIZE / (1024.0 * 1024.0)) / (duration / 1000000.0);
+    };
+
+    std::cout << "===============================\n";
+    std::cout << "XTS多扇区加密吞吐量 (64MB数据, " << std::dec << pool.size() << "线程):\n\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  512B扇区 单线程: " << measure(512, nullptr) << " MB/s\n";
+    std::cout << "  512B扇区 多线程: " << measure(512, &pool) << " MB/s\n";
+    std::cout << "  4KB扇区  单线程: " << measure(4096, nullptr) << " MB/s\n";
+    std::cout << "  4KB扇区  多线程: " << measure(4096, &pool) << " MB/s\n";
+}
+
+// 文件CTR加解密验证：mmap路径、双缓冲路径、原地处理都应与内存中的CTR结果一致
+bool verify_SM4_file() {
+    const SM4Key key(Key);
+    uint8_t iv[16];
+    generate_random_data(iv, 16);
+
+    // 跨越多个双缓冲窗口且末尾不足一个分组
+    const size_t LEN = FILE_STREAM_WINDOW * 2 + 12345;
+    std::vector<uint8_t> plain(LEN), reference(LEN), output(LEN);
+    generate_random_data(plain.data(), LEN);
+    SM4Crypt_CTR(key, iv, 0, plain.data(), reference.data(), LEN);
+
+    const char* in_path = "sm4_ctr_test_in.bin";
+    const char* out_path = "sm4_ctr_test_out.bin";
+    auto write_file = [](const char* path, const std::vector<uint8_t>& data) {
+        FILE* f = fopen(path, "wb");
+        bool ok = f && fwrite(data.data(), 1, data.size(), f) == data.size();
+        return f && (fclose(f) == 0) && ok;
+    };
+    auto read_file = [](const char* path, std::vector<uint8_t>& data) {
+        FILE* f = fopen(path, "rb");
+        bool ok = f && fread(data.data(), 1, data.size(), f) == data.size() && fgetc(f) == EOF;
+        if (f) {
+            fclose(f);
+        }
+        return ok;
+    };
+
+    SM4ThreadPool pool(4);
+    bool ok = write_file(in_path, plain);
+
+    ok = ok && SM4Crypt_CTR_file(key, iv, in_path, out_path, &pool) && read_file(out_path, output);
+    ok = ok && output == reference;
+
+    ok = ok && sm4_ctr_file_stdio(key, iv, in_path, out_path, nullptr) && read_file(out_path, output);
+    ok = ok && output == reference;
+
+    // 原地解密还原明文
+    ok = ok && SM4Crypt_CTR_file(key, iv, out_path, out_path, nullptr) && read_file(out_path, output);
+    ok = ok && output == plain;
+
+    // 长度恰好为窗口整数倍时，读线程最后一次读到0字节
+    plain.resize(FILE_STREAM_WINDOW * 2);
+    reference.resize(FILE_STREAM_WINDOW * 2);
+    output.resize(FILE_STREAM_WINDOW * 2);
+    ok = ok && write_file(in_path, plain);
+    ok = ok && sm4_ctr_file_stdio(key, iv, in_path, out_path, &pool) && read_file(out_path, output);
+    ok = ok && output == reference;
+
+#ifdef SM4_HAS_MMAP
+    // 输出不是普通文件时退回双缓冲路径：写到/dev/null，以及由另一个线程读取的FIFO
+    ok = ok && SM4Crypt_CTR_file(key, iv, in_path, "/dev/null", &pool);
+    const char* fifo_path = "sm4_ctr_test_fifo";
+    remove(fifo_path);
+    if (ok && mkfifo(fifo_path, 0600) == 0) {
+        std::vector<uint8_t> piped(reference.size());
+        bool piped_ok = false;
+        std::thread reader([&] { piped_ok = read_file(fifo_path, piped); });
+        ok = SM4Crypt_CTR_file(key, iv, in_path, fifo_path, &pool);
+        reader.join();
+        ok = ok && piped_ok && piped == reference;
+        remove(fifo_path);
+    }
+    else {
+        ok = false;
+    }
+#endif
+
+    remove(in_path);
+    remove(out_path);
+    std::cout << "文件流式CTR与内存CTR结果" << (ok ? "一致" : "不一致") << "\n";
+    return ok;
+}
+
+void benchmark_SM4_file() {
+    constexpr size_t FILE_SIZE = 256 * 1024 * 1024; // 256MB
+    const SM4Key key(Key);
+    uint8_t iv[16] = { 0 };
+    const char* in_path = "sm4_ctr_bench_in.bin";
+    const char* out_path = "sm4_ctr_bench_out.bin";
+
+    {
+        std::vector<uint8_t> chunk(FILE_STREAM_WINDOW);
+        generate_random_data(chunk.data(), chunk.size());
+        FILE* f = fopen(in_path, "wb");
+        if (!f) {
+            return;
+        }
+        for (size_t i = 0; i < FILE_SIZE; i += chunk.size()) {
+            fwrite(chunk.data(), 1, chunk.size(), f);
+        }
+        fclose(f);
+    }
+
+    SM4ThreadPool pool;
+    auto measure = [&](bool use_mmap) {
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok = use_mmap ? SM4Crypt_CTR_file(key, iv, in_path, out_path, &pool)
+            : sm4_ctr_file_stdio(key, iv, in_path, out_path, &pool);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        return ok ? (FILE_SIZE / (1024.0 * 1024.0)) / (duration / 1000000.0) : 0.0;
+    };
+    double mmap_throughput = measure(true);
+    double stream_throughput = measure(false);
+    remove(in_path);
+    remove(out_path);
+
+    std::cout << "===============================\n";
+    std::cout << "文件CTR加密吞吐量 (256MB文件, " << std::dec << pool.size() << "线程):\n\n";
+    std::cout << "  mmap:     " << std::fixed << std::setprecision(2) << mmap_throughput << " MB/s\n";
+    std::cout << "  双缓冲:   " << std::fixed << std::setprecision(2) << stream_throughput << " MB/s\n";
+}
+
+// 输出检测到的CPU特性与当前后端
+void print_cpu_features() {
+    const CPUFeatures& f = cpu_features();
+    std::cout << "CPU特性:";
+    std::cout << (f.ssse3 ? " SSSE3" : "") << (f.sse41 ? " SSE4.1" : "") << (f.aesni ? " AES-NI" : "");
+    std::cout << (f.pclmulqdq ? " PCLMULQDQ" : "") << (f.avx2 ? " AVX2" : "") << (f.avx512f ? " AVX-512F" : "");
+    std::cout << (f.avx512bw ? " AVX-512BW" : "") << (f.vaes ? " VAES" : "") << (f.vpclmulqdq ? " VPCLMULQDQ" : "");
+    std::cout << "\nSM4后端: " << sm4_backend().name << "\n";
+}
+
+// 在本机支持的每个后端上运行多分组/比特切片/多密钥验证，结束后恢复原后端
+bool verify_SM4_backends() {
+    const char* current = sm4_backend().name;
+    bool ok = true;
+    for (const SM4Backend& b : SM4_BACKENDS) {
+        if (!b.supported(cpu_features())) {
+            continue;
+        }
+        sm4_set_backend(b.name);
+        std::cout << "[" << b.name << "] ";
+        ok = verify_SM4_blocks() && ok;
+        std::cout << "[" << b.name << "] ";
+        ok = verify_SM4_bitsliced() && ok;
+        std::cout << "[" << b.name << "] ";
+        ok = verify_SM4_multikey() && ok;
+    }
+    sm4_set_backend(current);
+    return ok;
+}
+
+// 解析32个十六进制字符为16字节
+bool parse_hex16(const char* hex, uint8_t out[16]) {
+    if (strlen(hex) != 32) {
+        return false;
+    }
+    for (int i = 0; i < 16; ++i) {
+        unsigned v;
+        if (sscanf(hex + i * 2, "%2x", &v) != 1) {
+            return false;
+        }
+        out[i] = (uint8_t)v;
+    }
+    return true;
+}
+
+// 命令行：ctr <密钥hex> <IV hex> <输入文件> <输出文件>，输入/输出为"-"时使用标准输入/输出
+int run_cli(int argc, char* argv[]) {
+    uint8_t key_bytes[16], iv[16];
+    if (argc != 6 || strcmp(argv[1], "ctr") != 0 || !parse_hex16(argv[2], key_bytes) || !parse_hex16(argv[3], iv)) {
+        std::cerr << "用法: " << argv[0] << " ctr <密钥(32个十六进制字符)> <IV(32个十六进制字符)> <输入文件|-> <输出文件|->\n";
+        std::cerr << "CTR模式加密与解密为同一操作；不带参数运行时执行自测与性能测试\n";
+        return 2;
+    }
+    const SM4Key key(key_bytes);
+    SM4ThreadPool pool;
+    bool ok;
+    if (strcmp(argv[4], "-") == 0 || strcmp(argv[5], "-") == 0) {
+        FILE* in = strcmp(argv[4], "-") == 0 ? stdin : fopen(argv[4], "rb");
+        FILE* out = strcmp(argv[5], "-") == 0 ? stdout : fopen(argv[5], "wb");
+        ok = in && out && SM4Crypt_CTR_stream(key, iv, in, out, &pool);
+        if (in && in != stdin) {
+            fclose(in);
+        }
+        if (out && out != stdout) {
+            ok = (fclose(out) == 0) && ok;
+        }
+    }
+    else {
+        ok = SM4Crypt_CTR_file(key, iv, argv[4], argv[5], &pool);
+    }
+    memset(key_bytes, 0, sizeof(key_bytes));
+    if (!ok) {
+        std::cerr << "处理失败: " << argv[4] << " -> " << argv[5] << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+
 
-int main()
+int main(int argc, char* argv[])
 {
-    uint32_t rk[32];
-    RoundKeyGen(rk, Key);
+    if (argc > 1) {
+        return run_cli(argc, argv);
+    }
+
+    const SM4Key key(Key);
     uint8_t output[16];
-    SM4Encrypt(Plaintext, output, rk);
+    SM4Encrypt(Plaintext, output, key.encrypt_rk());
     std::cout << "加密结果: ";
     for (int i = 0; i < 16; ++i) {
         std::cout << std::hex << (int)output[i] << " ";
@@ -475,22 +2722,74 @@ int main()
     std::cout << std::endl;
 
     /// 逆序解密
-    uint32_t rk2[32];
-    for (int i = 0; i < 32; ++i) {
-        rk2[i] = rk[31 - i];
-    }
     uint8_t PLT[16];
-    SM4Encrypt(output, PLT, rk2);
+    SM4Encrypt(output, PLT, key.decrypt_rk());
     std::cout << "解密结果: ";
     for (int i = 0; i < 16; ++i) {
         std::cout << std::hex << (int)PLT[i] << " ";
     }
     std::cout << std::endl;
 
+    // 优化实现应与基础实现结果一致
+    uint8_t output_opt[16];
+    key.encrypt_block(Plaintext, output_opt);
+    if (memcmp(output, output_opt, 16) != 0) {
+        std::cout << "错误: 优化实现与基础实现结果不一致!" << std::endl;
+        return 1;
+    }
+
+    // 所有可用后端的正确性验证
+    print_cpu_features();
+    if (!verify_SM4_backends()) {
+        return 1;
+    }
+
     // 运行性能测试
     benchmark_SM4();
 
     //优化后的性能测试
     benchmark_SM4_opt();
+
+    // 多分组并行实现的正确性验证与性能测试
+    if (!verify_SM4_blocks()) {
+        return 1;
+    }
+    benchmark_SM4_blocks();
+
+    // 比特切片实现的正确性验证与性能测试
+    if (!verify_SM4_bitsliced()) {
+        return 1;
+    }
+    benchmark_SM4_bitsliced();
+
+    // 批量密钥扩展与多密钥加密
+    if (!verify_SM4_multikey()) {
+        return 1;
+    }
+    benchmark_SM4_keygen();
+
+    // CBC/CFB/OFB工作模式
+    if (!verify_SM4_modes()) {
+        return 1;
+    }
+    benchmark_SM4_modes();
+
+    // 多线程ECB/CTR
+    if (!verify_SM4_parallel()) {
+        return 1;
+    }
+    benchmark_SM4_parallel();
+
+    // XTS模式
+    if (!verify_SM4_xts()) {
+        return 1;
+    }
+    benchmark_SM4_xts();
+
+    // 文件流式CTR
+    if (!verify_SM4_file()) {
+        return 1;
+    }
+    benchmark_SM4_file();
     return 0;
 }
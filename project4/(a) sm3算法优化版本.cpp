@@ -4,6 +4,7 @@
 #include <chrono>
 #include <random>
 #include <iomanip>
+#include <immintrin.h>
 
 #define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
 
@@ -13,6 +14,25 @@ static const uint32_t IV[8] = {
     0xa96f30bc, 0x163138aa, 0xe38dee4d, 0xb0fb0e4e
 };
 
+// ɵֳSM3_T_ROT[j] = ROTL32(T_j, j mod 32)λֻݶΣ
+// ѹÿֱȡټѭλ
+struct SM3RoundConstants {
+    uint32_t t[64];
+};
+
+constexpr SM3RoundConstants make_round_constants() {
+    SM3RoundConstants r{};
+    for (int j = 0; j < 64; j++) {
+        const uint32_t T = j < 16 ? 0x79cc4519 : 0x7a879d8a;
+        const int n = j % 32;
+        r.t[j] = n == 0 ? T : ((T << n) | (T >> (32 - n)));
+    }
+    return r;
+}
+
+constexpr SM3RoundConstants SM3_T_ROT = make_round_constants();
+static_assert(SM3_T_ROT.t[16] == 0x9d8a7a87, "SM3ֳ");
+
 // Żû
 inline uint32_t P0(uint32_t x) {
     uint32_t rot9 = ROTL32(x, 9);
@@ -55,7 +75,7 @@ void optimized_message_schedule(const uint8_t* message, uint32_t* W) {
 void compression(uint32_t* H, const uint32_t* W) {
     uint32_t W1[64];
     for (int j = 0; j < 64; j++) {
-        W1[j] = P0(W[j] ^ W[j + 4]);
+        W1[j] = W[j] ^ W[j + 4];
     }
 
     uint32_t A = H[0], B = H[1], C = H[2], D = H[3];
@@ -72,9 +92,9 @@ void compression(uint32_t* H, const uint32_t* W) {
         B = A;
         A = TT1;
         H_val = G;
-        G = F;
+        G = ROTL32(F, 19);
         F = E;
-        E = TT2;
+        E = P0(TT2);
     }
 
     H[0] ^= A; H[1] ^= B; H[2] ^= C; H[3] ^= D;
@@ -85,7 +105,7 @@ void compression(uint32_t* H, const uint32_t* W) {
 void optimized_compression(uint32_t* H, const uint32_t* W) {
     uint32_t W1[64];
     for (int j = 0; j < 64; j++) {
-        W1[j] = P0(W[j] ^ W[j + 4]);
+        W1[j] = W[j] ^ W[j + 4];
     }
 
     uint32_t A = H[0], B = H[1], C = H[2], D = H[3];
@@ -93,7 +113,7 @@ void optimized_compression(uint32_t* H, const uint32_t* W) {
 
     // ǰ16
     for (int j = 0; j < 16; j++) {
-        uint32_t SS1 = ROTL32(ROTL32(A, 12) + E + ROTL32(0x79cc4519, j), 7);
+        uint32_t SS1 = ROTL32(ROTL32(A, 12) + E + SM3_T_ROT.t[j], 7);
         uint32_t SS2 = SS1 ^ ROTL32(A, 12);
         uint32_t TT1 = (A ^ B ^ C) + D + SS2 + W1[j];
         uint32_t TT2 = (E ^ F ^ G) + H_val + SS1 + W[j];
@@ -103,14 +123,14 @@ void optimized_compression(uint32_t* H, const uint32_t* W) {
         B = A;
         A = TT1;
         H_val = G;
-        G = F;
+        G = ROTL32(F, 19);
         F = E;
-        E = TT2;
+        E = P0(TT2);
     }
 
     // 48
     for (int j = 16; j < 64; j++) {
-        uint32_t SS1 = ROTL32(ROTL32(A, 12) + E + ROTL32(0x7a879d8a, j), 7);
+        uint32_t SS1 = ROTL32(ROTL32(A, 12) + E + SM3_T_ROT.t[j], 7);
         uint32_t SS2 = SS1 ^ ROTL32(A, 12);
         uint32_t TT1 = ((A & B) | (A & C) | (B & C)) + D + SS2 + W1[j];
         uint32_t TT2 = ((E & F) | ((~E) & G)) + H_val + SS1 + W[j];
@@ -120,21 +140,358 @@ void optimized_compression(uint32_t* H, const uint32_t* W) {
         B = A;
         A = TT1;
         H_val = G;
-        G = F;
+        G = ROTL32(F, 19);
         F = E;
-        E = TT2;
+        E = P0(TT2);
     }
 
     H[0] ^= A; H[1] ^= B; H[2] ^= C; H[3] ^= D;
     H[4] ^= E; H[5] ^= F; H[6] ^= G; H[7] ^= H_val;
 }
 
+// ===================== ʱ˷ =====================
+// ʱcpuidCPUԣѶѹ󶨵ǰCPUֵ֧ʵ֡
+// avx2scalarͬһݴ룬AVX2+BMI2룺ѭλrorx
+// W'ļ㱻ԶSM3_BACKEND=scalar|avx2|avx512ǿָˡ
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <cstdlib>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SM3_TARGET(features) __attribute__((target(features)))
+#define SM3_FLATTEN __attribute__((flatten))
+#else
+#define SM3_TARGET(features)
+#define SM3_FLATTEN
+#endif
+
+struct CPUFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+    bool bmi2 = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+};
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t r[4]) {
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuidex(regs, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i) {
+        r[i] = (uint32_t)regs[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// XCR0ϵͳǷлʱYMM/ZMMĴ
+static uint64_t read_xcr0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static CPUFeatures detect_cpu_features() {
+    CPUFeatures f;
+    uint32_t r[4];
+    cpuid(0, 0, r);
+    const uint32_t max_leaf = r[0];
+
+    cpuid(1, 0, r);
+    f.sse41 = (r[2] >> 19) & 1;
+    const bool osxsave = (r[2] >> 27) & 1;
+    const bool avx = (r[2] >> 28) & 1;
+    const uint64_t xcr0 = osxsave ? read_xcr0() : 0;
+    const bool ymm_enabled = avx && (xcr0 & 0x6) == 0x6;
+    const bool zmm_enabled = ymm_enabled && (xcr0 & 0xE0) == 0xE0;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, r);
+        f.avx2 = ymm_enabled && ((r[1] >> 5) & 1);
+        f.bmi2 = (r[1] >> 8) & 1;
+        f.avx512f = zmm_enabled && ((r[1] >> 16) & 1);
+        f.avx512bw = zmm_enabled && ((r[1] >> 30) & 1);
+    }
+    return f;
+}
+
+const CPUFeatures& cpu_features() {
+    static const CPUFeatures features = detect_cpu_features();
+    return features;
+}
+
+// ѹnblocks64ֽڷ
+static inline void compress_blocks_generic(uint32_t* H, const uint8_t* blocks, size_t nblocks) {
+    for (size_t i = 0; i < nblocks; i++) {
+        uint32_t W[68];
+        optimized_message_schedule(blocks + i * 64, W);
+        optimized_compression(H, W);
+    }
+}
+
+static void compress_blocks_scalar(uint32_t* H, const uint8_t* blocks, size_t nblocks) {
+    compress_blocks_generic(H, blocks, nblocks);
+}
+
+SM3_TARGET("avx2,bmi2") SM3_FLATTEN static void compress_blocks_avx2(uint32_t* H, const uint8_t* blocks, size_t nblocks) {
+    compress_blocks_generic(H, blocks, nblocks);
+}
+
+// ===================== ໺SM3ѹ =====================
+// Ϣ64ѹϸУԪС໺ʵÿͨһ
+// Ϣ״ִ̬(H[][ͨ])8(AVX2)16(AVX-512)ͨͬʱѹԵһ顣
+// ͨķ鰴롢ֽתתãõÿϢֵAVX-512vproldѭλ
+// FF/GG/P0/P1е߼һvpternlogdɡ
+constexpr size_t SM3_MB_MAX_LANES = 16;
+
+#define SM3_TARGET_AVX2 SM3_TARGET("avx2")
+#define SM3_TARGET_AVX512 SM3_TARGET("avx2,avx512f,avx512bw")
+
+SM3_TARGET_AVX2 static inline __m256i rotl_avx2(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+// 8x832λתãr[i]ĵjr[j]ĵiֻ
+SM3_TARGET_AVX2 static inline void transpose_8x8_avx2(__m256i r[8]) {
+    __m256i t[8], u[8];
+    for (int k = 0; k < 4; ++k) {
+        t[2 * k] = _mm256_unpacklo_epi32(r[2 * k], r[2 * k + 1]);
+        t[2 * k + 1] = _mm256_unpackhi_epi32(r[2 * k], r[2 * k + 1]);
+    }
+    for (int k = 0; k < 2; ++k) {
+        u[4 * k + 0] = _mm256_unpacklo_epi64(t[4 * k], t[4 * k + 2]);
+        u[4 * k + 1] = _mm256_unpackhi_epi64(t[4 * k], t[4 * k + 2]);
+        u[4 * k + 2] = _mm256_unpacklo_epi64(t[4 * k + 1], t[4 * k + 3]);
+        u[4 * k + 3] = _mm256_unpackhi_epi64(t[4 * k + 1], t[4 * k + 3]);
+    }
+    for (int j = 0; j < 4; ++j) {
+        r[j] = _mm256_permute2x128_si256(u[j], u[4 + j], 0x20);
+        r[4 + j] = _mm256_permute2x128_si256(u[j], u[4 + j], 0x31);
+    }
+}
+
+// һѹ8ͨ
+template <bool FIRST16>
+SM3_TARGET_AVX2 static inline void sm3_round_avx2(__m256i& A, __m256i& B, __m256i& C, __m256i& D,
+    __m256i& E, __m256i& F, __m256i& G, __m256i& H, __m256i w, __m256i w1, uint32_t t) {
+    __m256i a12 = rotl_avx2(A, 12);
+    __m256i SS1 = rotl_avx2(_mm256_add_epi32(_mm256_add_epi32(a12, E), _mm256_set1_epi32((int)t)), 7);
+    __m256i SS2 = _mm256_xor_si256(SS1, a12);
+    __m256i ff, gg;
+    if (FIRST16) {
+        ff = _mm256_xor_si256(_mm256_xor_si256(A, B), C);
+        gg = _mm256_xor_si256(_mm256_xor_si256(E, F), G);
+    }
+    else {
+        ff = _mm256_or_si256(_mm256_and_si256(A, B), _mm256_and_si256(_mm256_or_si256(A, B), C));
+        gg = _mm256_or_si256(_mm256_and_si256(E, F), _mm256_andnot_si256(E, G));
+    }
+    __m256i TT1 = _mm256_add_epi32(_mm256_add_epi32(ff, D), _mm256_add_epi32(SS2, w1));
+    __m256i TT2 = _mm256_add_epi32(_mm256_add_epi32(gg, H), _mm256_add_epi32(SS1, w));
+    D = C;
+    C = rotl_avx2(B, 9);
+    B = A;
+    A = TT1;
+    H = G;
+    G = rotl_avx2(F, 19);
+    F = E;
+    E = _mm256_xor_si256(_mm256_xor_si256(TT2, rotl_avx2(TT2, 9)), rotl_avx2(TT2, 17));
+}
+
+// 8ͨѹһ飬blocks[l]Ϊͨl64ֽڷ
+SM3_TARGET_AVX2 static void sm3_compress_mb_avx2(uint32_t H[8][SM3_MB_MAX_LANES], const uint8_t* const blocks[]) {
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m256i W[68];
+    for (int half = 0; half < 2; ++half) {
+        __m256i r[8];
+        for (int l = 0; l < 8; ++l) {
+            r[l] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(blocks[l] + half * 32)), bswap);
+        }
+        transpose_8x8_avx2(r);
+        for (int i = 0; i < 8; ++i) {
+            W[half * 8 + i] = r[i];
+        }
+    }
+    for (int i = 16; i < 68; ++i) {
+        __m256i t = _mm256_xor_si256(_mm256_xor_si256(W[i - 16], W[i - 9]), rotl_avx2(W[i - 3], 15));
+        t = _mm256_xor_si256(_mm256_xor_si256(t, rotl_avx2(t, 15)), rotl_avx2(t, 23));
+        W[i] = _mm256_xor_si256(_mm256_xor_si256(t, rotl_avx2(W[i - 13], 7)), W[i - 6]);
+    }
+
+    __m256i V[8];
+    for (int i = 0; i < 8; ++i) {
+        V[i] = _mm256_loadu_si256((const __m256i*)H[i]);
+    }
+    __m256i A = V[0], B = V[1], C = V[2], D = V[3], E = V[4], F = V[5], G = V[6], Hh = V[7];
+    for (int j = 0; j < 16; ++j) {
+        sm3_round_avx2<true>(A, B, C, D, E, F, G, Hh, W[j], _mm256_xor_si256(W[j], W[j + 4]), SM3_T_ROT.t[j]);
+    }
+    for (int j = 16; j < 64; ++j) {
+        sm3_round_avx2<false>(A, B, C, D, E, F, G, Hh, W[j], _mm256_xor_si256(W[j], W[j + 4]), SM3_T_ROT.t[j]);
+    }
+    const __m256i out[8] = { A, B, C, D, E, F, G, Hh };
+    for (int i = 0; i < 8; ++i) {
+        _mm256_storeu_si256((__m256i*)H[i], _mm256_xor_si256(V[i], out[i]));
+    }
+}
+
+// GCC 12avx512fintrin.h_mm512_undefined_epi32"__Y = __Y"ʾδֵ
+// AVX-512ں˺-Wall²-Wuninitialized󱨣ֻһڹر
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+// 16x1632λתã128λڽ֯(ͬ8x8)vshufi32x4128λ
+SM3_TARGET_AVX512 static inline void transpose_16x16_avx512(__m512i r[16]) {
+    __m512i t[16], u[16];
+    for (int k = 0; k < 8; ++k) {
+        t[2 * k] = _mm512_unpacklo_epi32(r[2 * k], r[2 * k + 1]);
+        t[2 * k + 1] = _mm512_unpackhi_epi32(r[2 * k], r[2 * k + 1]);
+    }
+    for (int k = 0; k < 4; ++k) {
+        u[4 * k + 0] = _mm512_unpacklo_epi64(t[4 * k], t[4 * k + 2]);
+        u[4 * k + 1] = _mm512_unpackhi_epi64(t[4 * k], t[4 * k + 2]);
+        u[4 * k + 2] = _mm512_unpacklo_epi64(t[4 * k + 1], t[4 * k + 3]);
+        u[4 * k + 3] = _mm512_unpackhi_epi64(t[4 * k + 1], t[4 * k + 3]);
+    }
+    // u[4k+j]ĵL128λΪ4L+jС4k..4k+3
+    for (int j = 0; j < 4; ++j) {
+        __m512i v0 = _mm512_shuffle_i32x4(u[j], u[4 + j], 0x88);
+        __m512i v1 = _mm512_shuffle_i32x4(u[j], u[4 + j], 0xDD);
+        __m512i w0 = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], 0x88);
+        __m512i w1 = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], 0xDD);
+        r[j] = _mm512_shuffle_i32x4(v0, w0, 0x88);
+        r[4 + j] = _mm512_shuffle_i32x4(v1, w1, 0x88);
+        r[8 + j] = _mm512_shuffle_i32x4(v0, w0, 0xDD);
+        r[12 + j] = _mm512_shuffle_i32x4(v1, w1, 0xDD);
+    }
+}
+
+// һѹ16ͨ0x96Ϊ0xE8Ϊ0xCAΪE ? F : G
+template <bool FIRST16>
+SM3_TARGET_AVX512 static inline void sm3_round_avx512(__m512i& A, __m512i& B, __m512i& C, __m512i& D,
+    __m512i& E, __m512i& F, __m512i& G, __m512i& H, __m512i w, __m512i w1, uint32_t t) {
+    __m512i a12 = _mm512_rol_epi32(A, 12);
+    __m512i SS1 = _mm512_rol_epi32(_mm512_add_epi32(_mm512_add_epi32(a12, E), _mm512_set1_epi32((int)t)), 7);
+    __m512i SS2 = _mm512_xor_si512(SS1, a12);
+    __m512i ff = _mm512_ternarylogic_epi32(A, B, C, FIRST16 ? 0x96 : 0xE8);
+    __m512i gg = _mm512_ternarylogic_epi32(E, F, G, FIRST16 ? 0x96 : 0xCA);
+    __m512i TT1 = _mm512_add_epi32(_mm512_add_epi32(ff, D), _mm512_add_epi32(SS2, w1));
+    __m512i TT2 = _mm512_add_epi32(_mm512_add_epi32(gg, H), _mm512_add_epi32(SS1, w));
+    D = C;
+    C = _mm512_rol_epi32(B, 9);
+    B = A;
+    A = TT1;
+    H = G;
+    G = _mm512_rol_epi32(F, 19);
+    F = E;
+    E = _mm512_ternarylogic_epi32(TT2, _mm512_rol_epi32(TT2, 9), _mm512_rol_epi32(TT2, 17), 0x96);
+}
+
+// 16ͨѹһ
+SM3_TARGET_AVX512 static void sm3_compress_mb_avx512(uint32_t H[8][SM3_MB_MAX_LANES], const uint8_t* const blocks[]) {
+    const __m512i bswap = _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203);
+    __m512i W[68];
+    for (int l = 0; l < 16; ++l) {
+        W[l] = _mm512_shuffle_epi8(_mm512_loadu_si512((const void*)blocks[l]), bswap);
+    }
+    transpose_16x16_avx512(W);
+    for (int i = 16; i < 68; ++i) {
+        __m512i t = _mm512_ternarylogic_epi32(W[i - 16], W[i - 9], _mm512_rol_epi32(W[i - 3], 15), 0x96);
+        t = _mm512_ternarylogic_epi32(t, _mm512_rol_epi32(t, 15), _mm512_rol_epi32(t, 23), 0x96);
+        W[i] = _mm512_ternarylogic_epi32(t, _mm512_rol_epi32(W[i - 13], 7), W[i - 6], 0x96);
+    }
+
+    __m512i V[8];
+    for (int i = 0; i < 8; ++i) {
+        V[i] = _mm512_loadu_si512((const void*)H[i]);
+    }
+    __m512i A = V[0], B = V[1], C = V[2], D = V[3], E = V[4], F = V[5], G = V[6], Hh = V[7];
+    for (int j = 0; j < 16; ++j) {
+        sm3_round_avx512<true>(A, B, C, D, E, F, G, Hh, W[j], _mm512_xor_si512(W[j], W[j + 4]), SM3_T_ROT.t[j]);
+    }
+    for (int j = 16; j < 64; ++j) {
+        sm3_round_avx512<false>(A, B, C, D, E, F, G, Hh, W[j], _mm512_xor_si512(W[j], W[j + 4]), SM3_T_ROT.t[j]);
+    }
+    const __m512i out[8] = { A, B, C, D, E, F, G, Hh };
+    for (int i = 0; i < 8; ++i) {
+        _mm512_storeu_si512((void*)H[i], _mm512_xor_si512(V[i], out[i]));
+    }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// һ˼һʵ֣ȼӸߵ
+struct SM3Backend {
+    const char* name;
+    bool (*supported)(const CPUFeatures& f);
+    void (*compress_blocks)(uint32_t* H, const uint8_t* blocks, size_t nblocks);
+    // ໺ѹmb_lanesͨѹһ飻mb_lanesΪ1ʱûж໺ʵ
+    size_t mb_lanes;
+    void (*compress_mb)(uint32_t H[8][SM3_MB_MAX_LANES], const uint8_t* const blocks[]);
+};
+
+static const SM3Backend SM3_BACKENDS[] = {
+    { "avx512", [](const CPUFeatures& f) { return f.avx512f && f.avx512bw && f.avx2 && f.bmi2; },
+      compress_blocks_avx2, 16, sm3_compress_mb_avx512 },
+    { "avx2", [](const CPUFeatures& f) { return f.avx2 && f.bmi2; }, compress_blocks_avx2, 8, sm3_compress_mb_avx2 },
+    { "scalar", [](const CPUFeatures&) { return true; }, compress_blocks_scalar, 1, nullptr },
+};
+
+// ֲҵǰCPUֵ֧ĺˣnameΪջ"auto"ʱĺˣҲnullptr
+const SM3Backend* sm3_find_backend(const char* name) {
+    const bool best = name == nullptr || *name == '\0' || strcmp(name, "auto") == 0;
+    for (const SM3Backend& b : SM3_BACKENDS) {
+        if ((best || strcmp(name, b.name) == 0) && b.supported(cpu_features())) {
+            return &b;
+        }
+    }
+    return nullptr;
+}
+
+static const SM3Backend* select_sm3_backend() {
+    const char* forced = getenv("SM3_BACKEND");
+    const SM3Backend* b = sm3_find_backend(forced);
+    if (!b) {
+        std::cerr << "SM3_BACKEND=" << forced << " ڻǰCPU֧֣Զѡ\n";
+        b = sm3_find_backend(nullptr);
+    }
+    return b;
+}
+
+static const SM3Backend* g_sm3_backend = select_sm3_backend();
+
+const SM3Backend& sm3_backend() { return *g_sm3_backend; }
+
+// л(ڲ)ڽеĹϣ㲢
+bool sm3_set_backend(const char* name) {
+    const SM3Backend* b = sm3_find_backend(name);
+    if (b) {
+        g_sm3_backend = b;
+    }
+    return b != nullptr;
+}
+
+void sm3_compress_blocks(uint32_t* H, const uint8_t* blocks, size_t nblocks) {
+    g_sm3_backend->compress_blocks(H, blocks, nblocks);
+}
+
 // ԭʼSM3㷨
 void sm3(const uint8_t* input, size_t len, uint8_t* output) {
     uint32_t H[8];
     memcpy(H, IV, sizeof(IV));
 
-    size_t block_count = (len + 8 + 63) / 64;
+    size_t block_count = (len + 9 + 63) / 64; // 1ֽ0x808ֽڳ
     std::vector<uint8_t> padded_input(block_count * 64, 0);
     memcpy(padded_input.data(), input, len);
 
@@ -158,27 +515,31 @@ void sm3(const uint8_t* input, size_t len, uint8_t* output) {
     }
 }
 
-// ŻSM3㷨
-void optimized_sm3(const uint8_t* input, size_t len, uint8_t* output) {
-    uint32_t H[8];
-    memcpy(H, IV, sizeof(IV));
+// ===================== ʽSM3 =====================
+// init / update / finalֱӴӵ÷ѹֻ治һβ
+// ڴռϢ޹أΪϢ丱
 
-    size_t block_count = (len + 8 + 63) / 64;
-    std::vector<uint8_t> padded_input(block_count * 64, 0);
-    memcpy(padded_input.data(), input, len);
+typedef struct {
+    uint32_t H[8];
+    uint8_t buf[64];    // δһ
+    size_t buf_len;
+    uint64_t total_len; // ֽ
+} SM3Ctx;
 
-    padded_input[len] = 0x80;
-    uint64_t bit_len = len * 8;
+// Ϣĩβ飺rem(119)ֽʣ || 0x80 || 0 || 64λسȣط(12)
+static size_t sm3_pad_tail(const uint8_t* rest, size_t rem, uint64_t total_len, uint8_t tail[128]) {
+    size_t nblocks = rem < 56 ? 1 : 2;
+    memset(tail, 0, nblocks * 64);
+    memcpy(tail, rest, rem);
+    tail[rem] = 0x80;
+    uint64_t bit_len = total_len * 8;
     for (int i = 0; i < 8; i++) {
-        padded_input[block_count * 64 - 8 + i] = (bit_len >> (56 - i * 8)) & 0xff;
-    }
-
-    for (size_t i = 0; i < block_count; i++) {
-        uint32_t W[68];
-        optimized_message_schedule(padded_input.data() + i * 64, W);
-        optimized_compression(H, W);
+        tail[nblocks * 64 - 8 + i] = (bit_len >> (56 - i * 8)) & 0xff;
     }
+    return nblocks;
+}
 
+static void sm3_store_digest(const uint32_t H[8], uint8_t* output) {
     for (int i = 0; i < 8; i++) {
         output[i * 4] = (H[i] >> 24) & 0xff;
         output[i * 4 + 1] = (H[i] >> 16) & 0xff;
@@ -187,6 +548,269 @@ void optimized_sm3(const uint8_t* input, size_t len, uint8_t* output) {
     }
 }
 
+void sm3_init(SM3Ctx* ctx) {
+    memcpy(ctx->H, IV, sizeof(IV));
+    ctx->buf_len = 0;
+    ctx->total_len = 0;
+}
+
+void sm3_update(SM3Ctx* ctx, const uint8_t* data, size_t len) {
+    ctx->total_len += len;
+    // 1. Ȳķ
+    if (ctx->buf_len > 0) {
+        size_t n = 64 - ctx->buf_len < len ? 64 - ctx->buf_len : len;
+        memcpy(ctx->buf + ctx->buf_len, data, n);
+        ctx->buf_len += n;
+        data += n;
+        len -= n;
+        if (ctx->buf_len < 64) {
+            return;
+        }
+        sm3_compress_blocks(ctx->H, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    // 2. ֱӴѹ
+    size_t nblocks = len / 64;
+    if (nblocks > 0) {
+        sm3_compress_blocks(ctx->H, data, nblocks);
+        data += nblocks * 64;
+        len -= nblocks * 64;
+    }
+    // 3. ʣಿһ
+    memcpy(ctx->buf, data, len);
+    ctx->buf_len = len;
+}
+
+void sm3_final(SM3Ctx* ctx, uint8_t* output) {
+    uint8_t tail[128];
+    size_t nblocks = sm3_pad_tail(ctx->buf, ctx->buf_len, ctx->total_len, tail);
+    sm3_compress_blocks(ctx->H, tail, nblocks);
+    sm3_store_digest(ctx->H, output);
+}
+
+// ===================== ϢSM3 =====================
+// ̱ʶĵã0~55ֽһ飬56~119ֽ顣
+// ֱջϵĶй鲢ѹSM3CtxĻͨ߼
+// ڱ֪ʱ(sm3_fixed<LEN>)Լ0x80ͳֶελҲǳ
+constexpr size_t SM3_SHORT_MAX = 119;
+
+// ÷֤len + 9 <= NBLOCKS * 64
+template <size_t NBLOCKS>
+static inline void sm3_short_blocks(const uint8_t* input, size_t len, uint8_t* output) {
+    uint8_t block[NBLOCKS * 64] = { 0 };
+    memcpy(block, input, len);
+    block[len] = 0x80;
+    uint64_t bit_len = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        block[NBLOCKS * 64 - 8 + i] = (bit_len >> (56 - i * 8)) & 0xff;
+    }
+    uint32_t H[8];
+    memcpy(H, IV, sizeof(IV));
+    sm3_compress_blocks(H, block, NBLOCKS);
+    sm3_store_digest(H, output);
+}
+
+// ϢSM3_SHORT_MAXֽ߶·Ϣ˻SM3Ctxͨʵ
+void sm3_short(const uint8_t* input, size_t len, uint8_t* output) {
+    if (len < 56) {
+        sm3_short_blocks<1>(input, len, output);
+    }
+    else if (len <= SM3_SHORT_MAX) {
+        sm3_short_blocks<2>(input, len, output);
+    }
+    else {
+        SM3Ctx ctx;
+        sm3_init(&ctx);
+        sm3_update(&ctx, input, len);
+        sm3_final(&ctx, output);
+    }
+}
+
+// ֪ȵĶϢ綨ļ
+template <size_t LEN>
+void sm3_fixed(const uint8_t* input, uint8_t* output) {
+    static_assert(LEN <= SM3_SHORT_MAX, "sm3_fixedֻڲ119ֽڵϢ");
+    sm3_short_blocks<(LEN < 56 ? 1 : 2)>(input, LEN, output);
+}
+
+// ŻSM3㷨һԽӿڣϢ߶·ʽʵ
+void optimized_sm3(const uint8_t* input, size_t len, uint8_t* output) {
+    sm3_short(input, len, output);
+}
+
+// ===================== ໺SM3 =====================
+// һμϢժҪÿͨһϢÿͨѹԼһ飺
+// ֱӴӵ÷ȡֻĩβ1~2ͨԼĻСĳͨϢ
+// һ̲һϢҲøͨæµûϢɻֻʣͨʱ
+// ѹ󲿷ڿתʣϢɵʵɡ
+
+// ໺SM3һϢ
+typedef struct {
+    const uint8_t* data;
+    size_t len;
+    uint8_t* digest;  // 32ֽժҪ
+} sm3_mb_job;
+
+// ʣԾͨûϢʱõʵ
+constexpr size_t SM3_MB_DRAIN_LANES = 2;
+
+// һͨڴϢ
+struct SM3Lane {
+    const sm3_mb_job* job;      // nullptrʾ
+    const uint8_t* next;        // һ
+    size_t full_left;           // ʣ
+    size_t tail_blocks;
+    size_t tail_done;
+    uint8_t tail[128];          // 
+};
+
+static void sm3_lane_assign(SM3Lane& lane, const sm3_mb_job* job) {
+    lane.job = job;
+    lane.next = job->data;
+    lane.full_left = job->len / 64;
+    lane.tail_blocks = sm3_pad_tail(job->data + lane.full_left * 64, job->len % 64, job->len, lane.tail);
+    lane.tail_done = 0;
+}
+
+void sm3_hash_batch(const sm3_mb_job* jobs, size_t n) {
+    const SM3Backend* b = g_sm3_backend;
+    if (b->mb_lanes <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+            optimized_sm3(jobs[i].data, jobs[i].len, jobs[i].digest);
+        }
+        return;
+    }
+
+    static const uint8_t idle_block[64] = { 0 };
+    alignas(64) uint32_t H[8][SM3_MB_MAX_LANES];
+    SM3Lane lanes[SM3_MB_MAX_LANES];
+    const uint8_t* blocks[SM3_MB_MAX_LANES];
+    const size_t nlanes = b->mb_lanes;
+    size_t next_job = 0, nactive = 0;
+
+    auto refill = [&](size_t l) {
+        if (next_job == n) {
+            lanes[l].job = nullptr;
+            return;
+        }
+        sm3_lane_assign(lanes[l], &jobs[next_job++]);
+        for (int w = 0; w < 8; ++w) {
+            H[w][l] = IV[w];
+        }
+        ++nactive;
+    };
+    for (size_t l = 0; l < nlanes; ++l) {
+        refill(l);
+    }
+
+    while (nactive > SM3_MB_DRAIN_LANES || (nactive > 0 && next_job < n)) {
+        for (size_t l = 0; l < nlanes; ++l) {
+            const SM3Lane& lane = lanes[l];
+            blocks[l] = !lane.job ? idle_block : lane.full_left > 0 ? lane.next : lane.tail + lane.tail_done * 64;
+        }
+        b->compress_mb(H, blocks);
+        for (size_t l = 0; l < nlanes; ++l) {
+            SM3Lane& lane = lanes[l];
+            if (!lane.job) {
+                continue;
+            }
+            if (lane.full_left > 0) {
+                lane.next += 64;
+                --lane.full_left;
+                continue;
+            }
+            if (++lane.tail_done < lane.tail_blocks) {
+                continue;
+            }
+            uint32_t h[8];
+            for (int w = 0; w < 8; ++w) {
+                h[w] = H[w][l];
+            }
+            sm3_store_digest(h, lane.job->digest);
+            --nactive;
+            refill(l);
+        }
+    }
+
+    // ʣͨõʵβ
+    for (size_t l = 0; l < nlanes; ++l) {
+        SM3Lane& lane = lanes[l];
+        if (!lane.job) {
+            continue;
+        }
+        uint32_t h[8];
+        for (int w = 0; w < 8; ++w) {
+            h[w] = H[w][l];
+        }
+        sm3_compress_blocks(h, lane.next, lane.full_left);
+        sm3_compress_blocks(h, lane.tail + lane.tail_done * 64, lane.tail_blocks - lane.tail_done);
+        sm3_store_digest(h, lane.job->digest);
+    }
+}
+
+// ̼ժҪkeys[i]ĳΪlens[i]ժҪдdigests(ÿ32ֽ)
+// ÿmb_lanesջϹ죬һͨһѹļʱ
+// ѹһΣSM3_SHORT_MAXֽڵļ
+void sm3_hash_short_batch(const uint8_t* const keys[], const size_t lens[], uint8_t* digests, size_t n) {
+    const SM3Backend* b = g_sm3_backend;
+    if (b->mb_lanes <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+            optimized_sm3(keys[i], lens[i], digests + i * 32);
+        }
+        return;
+    }
+
+    const size_t nlanes = b->mb_lanes;
+    alignas(64) uint8_t blocks[SM3_MB_MAX_LANES][128];
+    alignas(64) uint32_t H[8][SM3_MB_MAX_LANES];
+    const uint8_t* ptrs[SM3_MB_MAX_LANES];
+    size_t index[SM3_MB_MAX_LANES], nblocks[SM3_MB_MAX_LANES];
+
+    size_t i = 0;
+    while (i < n) {
+        size_t m = 0;
+        bool two = false;
+        for (; m < nlanes && i < n; ++i) {
+            if (lens[i] > SM3_SHORT_MAX) {
+                optimized_sm3(keys[i], lens[i], digests + i * 32);
+                continue;
+            }
+            nblocks[m] = sm3_pad_tail(keys[i], lens[i], lens[i], blocks[m]);
+            two = two || nblocks[m] == 2;
+            index[m++] = i;
+        }
+        if (m == 0) {
+            break;
+        }
+        // ͨظѹ0ķ飬
+        for (size_t l = 0; l < nlanes; ++l) {
+            ptrs[l] = blocks[l < m ? l : 0];
+            for (int w = 0; w < 8; ++w) {
+                H[w][l] = IV[w];
+            }
+        }
+        b->compress_mb(H, ptrs);
+        for (int pass = 1; pass <= (two ? 2 : 1); ++pass) {
+            if (pass == 2) {
+                for (size_t l = 0; l < m; ++l) {
+                    ptrs[l] = nblocks[l] == 2 ? blocks[l] + 64 : blocks[l];
+                }
+                b->compress_mb(H, ptrs);
+            }
+            for (size_t l = 0; l < m; ++l) {
+                if (nblocks[l] != (size_t)pass) {
+                    continue;
+                }
+                uint32_t h[8];
+                for (int w = 0; w < 8; ++w) {
+                    h[w] = H[w][l];
+                }
+                sm3_store_digest(h, digests + index[l] * 32);
+            }
+        }
+    }
+}
+
 // ===================== Թߺ =====================
 std::vector<uint8_t> generate_random_data(size_t size) {
     std::vector<uint8_t> data(size);
@@ -250,6 +874,155 @@ void compare_performance(size_t data_size, int iterations) {
     std::cout << "==============================" << std::endl;
 }
 
+// Ϣǰoptimized_sm3ΪϢ丱ѹʽʵְ64KBֶupdate
+// ڴֻһSM3Ctxʹͬһѹ
+void compare_streaming(size_t data_size, int iterations) {
+    auto data = generate_random_data(data_size);
+    uint8_t hash1[32], hash2[32];
+    const size_t PIECE = 64 * 1024;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        size_t block_count = (data_size + 9 + 63) / 64;
+        std::vector<uint8_t> padded_input(block_count * 64, 0);
+        memcpy(padded_input.data(), data.data(), data_size);
+        size_t tail_blocks = sm3_pad_tail(data.data() + data_size / 64 * 64, data_size % 64, data_size,
+            padded_input.data() + data_size / 64 * 64);
+        uint32_t H[8];
+        memcpy(H, IV, sizeof(IV));
+        sm3_compress_blocks(H, padded_input.data(), data_size / 64 + tail_blocks);
+        sm3_store_digest(H, hash1);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double copy_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        SM3Ctx ctx;
+        sm3_init(&ctx);
+        for (size_t off = 0; off < data.size(); off += PIECE) {
+            sm3_update(&ctx, data.data() + off, std::min(PIECE, data.size() - off));
+        }
+        sm3_final(&ctx, hash2);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double stream_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    double mb = (double)data_size * iterations / (1024.0 * 1024.0);
+    std::cout << "ʽSM3 (" << data_size / (1024 * 1024) << "MB, ÿupdate 64KB)" << std::endl;
+    std::cout << "  丱(" << data_size / (1024 * 1024) << "MB): " << std::fixed << std::setprecision(2)
+        << mb / (copy_us / 1e6) << " MB/s" << std::endl;
+    std::cout << "  SM3Ctx(ڴ " << sizeof(SM3Ctx) << "ֽ): " << mb / (stream_us / 1e6) << " MB/s" << std::endl;
+    if (memcmp(hash1, hash2, 32) != 0) {
+        std::cerr << ": ʽ㲻һ!" << std::endl;
+    }
+}
+
+// ̼ԭʼ㷨(丱)ͨʽ·Ϣ·̼ӿڶԱ
+void compare_short_keys(size_t key_len, size_t count, int iterations) {
+    auto data = generate_random_data(key_len * count);
+    std::vector<const uint8_t*> keys(count);
+    std::vector<size_t> lens(count, key_len);
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = data.data() + i * key_len;
+    }
+    std::vector<uint8_t> expected(count * 32), digests(count * 32);
+
+    auto run = [&](auto&& hash_all) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            hash_all();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / ((double)count * iterations);
+    };
+    double alloc_ns = run([&] {
+        for (size_t i = 0; i < count; i++) {
+            sm3(keys[i], key_len, expected.data() + i * 32);
+        }
+    });
+    double ctx_ns = run([&] {
+        for (size_t i = 0; i < count; i++) {
+            SM3Ctx ctx;
+            sm3_init(&ctx);
+            sm3_update(&ctx, keys[i], key_len);
+            sm3_final(&ctx, digests.data() + i * 32);
+        }
+    });
+    double short_ns = run([&] {
+        for (size_t i = 0; i < count; i++) {
+            sm3_short(keys[i], key_len, digests.data() + i * 32);
+        }
+    });
+    bool ok = digests == expected;
+    double batch_ns = run([&] {
+        sm3_hash_short_batch(keys.data(), lens.data(), digests.data(), count);
+    });
+    ok = ok && digests == expected;
+
+    std::cout << "̼SM3 (" << count << " x " << key_len << "ֽ, " << sm3_backend().name << ")" << std::endl;
+    std::cout << "  ԭʼ㷨(ѷ): " << std::fixed << std::setprecision(1) << alloc_ns << " ns/" << std::endl;
+    std::cout << "  SM3Ctxͨ·:   " << ctx_ns << " ns/" << std::endl;
+    std::cout << "  sm3_short:        " << short_ns << " ns/" << std::endl;
+    std::cout << "  ̼:         " << batch_ns << " ns/ (" << ctx_ns / batch_ns << "x)" << std::endl;
+    if (!ok) {
+        std::cerr << ": ̼ԭʼ㷨һ!" << std::endl;
+    }
+}
+
+// ໺SM3countϢoptimized_sm3sm3_hash_batchԱȣڱֵ֧ÿϲԡ
+// msg_sizeΪ0ʱϢ1..4096ֽ֮
+void compare_multibuffer(size_t msg_size, size_t count, int iterations) {
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<size_t> dis(1, 4096);
+    std::vector<size_t> lens(count);
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        lens[i] = msg_size ? msg_size : dis(gen);
+        total += lens[i];
+    }
+    auto data = generate_random_data(total);
+    std::vector<uint8_t> digests(count * 32), expected(count * 32);
+    std::vector<sm3_mb_job> jobs(count);
+    size_t off = 0;
+    for (size_t i = 0; i < count; i++) {
+        jobs[i] = { data.data() + off, lens[i], digests.data() + i * 32 };
+        off += lens[i];
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < count; i++) {
+            optimized_sm3(jobs[i].data, jobs[i].len, expected.data() + i * 32);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double single_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    double mb = (double)total * iterations / (1024.0 * 1024.0);
+
+    std::cout << "໺SM3 (" << count << ", " << (msg_size ? std::to_string(msg_size) + "ֽ" : std::string("1~4096ֽ")) << ")" << std::endl;
+    std::cout << "  optimized_sm3: " << std::fixed << std::setprecision(2) << mb / (single_us / 1e6) << " MB/s" << std::endl;
+    const char* current = sm3_backend().name;
+    for (const SM3Backend& b : SM3_BACKENDS) {
+        if (!b.supported(cpu_features()) || b.mb_lanes <= 1) {
+            continue;
+        }
+        sm3_set_backend(b.name);
+        start = std::chrono::high_resolution_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            sm3_hash_batch(jobs.data(), count);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double us = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cout << "  [" << b.name << "] sm3_hash_batch(" << b.mb_lanes << "ͨ): " << mb / (us / 1e6)
+            << " MB/s (" << std::setprecision(1) << single_us / us << "x)" << std::setprecision(2) << std::endl;
+        if (digests != expected) {
+            std::cout << ": [" << b.name << "] ໺㲻һ!" << std::endl;
+        }
+    }
+    sm3_set_backend(current);
+}
+
 // 
 int main() {
     // ȷԲ
@@ -264,7 +1037,12 @@ int main() {
     std::cout << "ŻSM3(\"abc\"): ";
     print_hash(hash2, 32);
 
-    if (memcmp(hash1, hash2, 32) == 0) {
+    // GB/T 32905-2016 ʾ1
+    const uint8_t expected_abc[32] = {
+        0x66, 0xc7, 0xf0, 0xf4, 0x62, 0xee, 0xed, 0xd9, 0xd1, 0xf2, 0xd4, 0x6b, 0xdc, 0x10, 0xe4, 0xe2,
+        0x41, 0x67, 0xc4, 0x87, 0x5c, 0xf2, 0xf7, 0xa2, 0x29, 0x7d, 0xa0, 0x2b, 0x8f, 0x4b, 0xa8, 0xe0
+    };
+    if (memcmp(hash1, hash2, 32) == 0 && memcmp(hash2, expected_abc, 32) == 0) {
         std::cout << "֤ͨ!" << std::endl;
     }
     else {
@@ -272,11 +1050,157 @@ int main() {
         return 1;
     }
 
+    // ģ64Ϊ56ʱҪһ(οֵOpenSSL)
+    {
+        const uint8_t expected_a56[32] = {
+            0xba, 0x00, 0xeb, 0xed, 0xaa, 0xb5, 0x40, 0x65, 0xa5, 0xfd, 0x4f, 0x9f, 0x56, 0x32, 0x60, 0x16,
+            0x20, 0x31, 0x66, 0xbc, 0xee, 0x3e, 0xed, 0x44, 0xea, 0x86, 0x8d, 0x59, 0xd6, 0x7a, 0xa3, 0xc8
+        };
+        std::vector<uint8_t> a56(56, 'a');
+        sm3(a56.data(), a56.size(), hash1);
+        optimized_sm3(a56.data(), a56.size(), hash2);
+        if (memcmp(hash1, expected_a56, 32) != 0 || memcmp(hash2, expected_a56, 32) != 0) {
+            std::cout << ": 56ֽϢȷ!" << std::endl;
+            return 1;
+        }
+    }
+
+    // ʽӿڣͬһϢֶͬupdateӦһԼͬ
+    {
+        auto stream_data = generate_random_data(1000);
+        sm3(stream_data.data(), stream_data.size(), hash1);
+        const size_t steps[] = { 1, 7, 55, 56, 63, 64, 65, 130, 1000 };
+        for (size_t step : steps) {
+            SM3Ctx ctx;
+            sm3_init(&ctx);
+            for (size_t off = 0; off < stream_data.size(); off += step) {
+                sm3_update(&ctx, stream_data.data() + off, std::min(step, stream_data.size() - off));
+            }
+            sm3_final(&ctx, hash2);
+            if (memcmp(hash1, hash2, 32) != 0) {
+                std::cout << ": ʽSM3(" << step << ")һ!" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "ʽSM3֤ͨ" << std::endl;
+    }
+
+    // Ϣ0~130ֽһԭʼ㷨Աȣһ/ı߽ԼSM3_SHORT_MAXʱ
+    // sm3_short˻ͨʵֵڶ汾֤ͬ
+    {
+        auto short_data = generate_random_data(130);
+        for (size_t len = 0; len <= 130; len++) {
+            sm3(short_data.data(), len, hash1);
+            optimized_sm3(short_data.data(), len, hash2);
+            bool ok = memcmp(hash1, hash2, 32) == 0;
+            sm3_short(short_data.data(), len, hash2);
+            ok = ok && memcmp(hash1, hash2, 32) == 0;
+            if (!ok) {
+                std::cout << ": ϢSM3(" << len << "ֽ)һ!" << std::endl;
+                return 1;
+            }
+        }
+        bool fixed_ok = true;
+        sm3(short_data.data(), 0, hash1);
+        sm3_fixed<0>(short_data.data(), hash2);
+        fixed_ok = fixed_ok && memcmp(hash1, hash2, 32) == 0;
+        sm3(short_data.data(), 32, hash1);
+        sm3_fixed<32>(short_data.data(), hash2);
+        fixed_ok = fixed_ok && memcmp(hash1, hash2, 32) == 0;
+        sm3(short_data.data(), 56, hash1);
+        sm3_fixed<56>(short_data.data(), hash2);
+        fixed_ok = fixed_ok && memcmp(hash1, hash2, 32) == 0;
+        sm3(short_data.data(), 119, hash1);
+        sm3_fixed<119>(short_data.data(), hash2);
+        fixed_ok = fixed_ok && memcmp(hash1, hash2, 32) == 0;
+        if (!fixed_ok) {
+            std::cout << ": SM3һ!" << std::endl;
+            return 1;
+        }
+        std::cout << "ϢSM3֤ͨ" << std::endl;
+    }
+
+    // ڱֵ֧ÿ֤
+    std::cout << "SM3: " << sm3_backend().name << std::endl;
+    const char* current = sm3_backend().name;
+    auto long_data = generate_random_data(1000);
+    sm3(long_data.data(), long_data.size(), hash1);
+    for (const SM3Backend& b : SM3_BACKENDS) {
+        if (!b.supported(cpu_features())) {
+            continue;
+        }
+        sm3_set_backend(b.name);
+        optimized_sm3(long_data.data(), long_data.size(), hash2);
+        if (memcmp(hash1, hash2, 32) != 0) {
+            std::cout << ": [" << b.name << "] ˽һ!" << std::endl;
+            return 1;
+        }
+        std::cout << "[" << b.name << "] ֤ͨ" << std::endl;
+    }
+    sm3_set_backend(current);
+
+    // ໺壺ȲȵϢ(0ֽڡ顢ԶϢ)ͨ
+    {
+        const size_t COUNT = 53;
+        std::vector<size_t> lens(COUNT);
+        for (size_t i = 0; i < COUNT; i++) {
+            lens[i] = (i * 37) % 200;
+        }
+        lens[3] = 0; lens[7] = 55; lens[8] = 56; lens[9] = 64; lens[10] = 119; lens[11] = 120; lens[20] = 5000;
+        auto mb_data = generate_random_data(5000);
+        std::vector<uint8_t> expected(COUNT * 32), digests(COUNT * 32);
+        std::vector<sm3_mb_job> jobs(COUNT);
+        for (size_t i = 0; i < COUNT; i++) {
+            sm3(mb_data.data() + i, lens[i] - (lens[i] == 5000 ? i : 0), expected.data() + i * 32);
+            jobs[i] = { mb_data.data() + i, lens[i] - (lens[i] == 5000 ? i : 0), digests.data() + i * 32 };
+        }
+        for (const SM3Backend& b : SM3_BACKENDS) {
+            if (!b.supported(cpu_features())) {
+                continue;
+            }
+            sm3_set_backend(b.name);
+            std::fill(digests.begin(), digests.end(), 0);
+            sm3_hash_batch(jobs.data(), COUNT);
+            if (digests != expected) {
+                std::cout << ": [" << b.name << "] ໺SM3һ!" << std::endl;
+                return 1;
+            }
+            // ̼0~130ѭ119ֽڵļ㣬ͨ
+            const size_t NKEYS = 131 + 5;
+            std::vector<const uint8_t*> keys(NKEYS);
+            std::vector<size_t> key_lens(NKEYS);
+            std::vector<uint8_t> key_digests(NKEYS * 32), key_expected(NKEYS * 32);
+            for (size_t k = 0; k < NKEYS; k++) {
+                keys[k] = mb_data.data() + k;
+                key_lens[k] = (k * 29) % 131;
+                sm3(keys[k], key_lens[k], key_expected.data() + k * 32);
+            }
+            sm3_hash_short_batch(keys.data(), key_lens.data(), key_digests.data(), NKEYS);
+            if (key_digests != key_expected) {
+                std::cout << ": [" << b.name << "] ̼SM3һ!" << std::endl;
+                return 1;
+            }
+            std::cout << "[" << b.name << "] ໺SM3֤ͨ" << std::endl;
+        }
+        sm3_set_backend(current);
+    }
+
     // ܶԱȲ
     compare_performance(1 * 1024, 10000);     // 1KB
     compare_performance(10 * 1024, 1000);     // 10KB
     compare_performance(100 * 1024, 100);     // 100KB
     compare_performance(1024 * 1024, 10);     // 1MB
 
+    compare_streaming(256 * 1024 * 1024, 2);  // 256MB
+
+    // ໺ܲ
+    compare_multibuffer(64, 100000, 5);
+    compare_multibuffer(1024, 10000, 5);
+    compare_multibuffer(0, 10000, 5);
+
+    // ̼ܲ
+    compare_short_keys(16, 100000, 5);
+    compare_short_keys(100, 100000, 5);
+
     return 0;
 }
\ No newline at end of file